@@ -7,6 +7,10 @@ dir	:= common
 include		$(dir)/Rules.mk
 dir	:= set1
 include		$(dir)/Rules.mk
+dir	:= tools
+include		$(dir)/Rules.mk
+dir	:= checks
+include		$(dir)/Rules.mk
 
 %.o:		%.c
 		$(COMP)
@@ -28,5 +32,9 @@ clean:
 run-all: targets ./run-all.sh
 	$(SH) ./run-all.sh
 
+.PHONY:		check
+check: targets $(TGT_CHECK) ./check-all.sh
+	$(SH) ./check-all.sh
+
 .SECONDARY:	$(CLEAN)
 
@@ -0,0 +1,31 @@
+#!/bin/sh
+
+color() {
+	printf '\033[%sm%s\033[m\n' "$@"
+}
+
+FAILED_CHECKS=0
+PASSED_CHECKS=0
+
+for check in $(find ./checks -type f -executable -name 'check-*' | sort);
+do
+	color '33' "Running: $check"
+
+	LD_LIBRARY_PATH=./common $check
+	RETCODE=$?
+
+	if [ "$RETCODE" -eq "0" ];
+	then
+		color '32' "Passed: $check"
+		PASSED_CHECKS=$((PASSED_CHECKS+1))
+	else
+		color '31' "Failed: $check"
+		FAILED_CHECKS=$((FAILED_CHECKS+1))
+	fi
+done
+
+TOTAL_CHECKS=$((PASSED_CHECKS+FAILED_CHECKS))
+
+echo "Passed $PASSED_CHECKS out of a total $TOTAL_CHECKS checks"
+
+[ "$FAILED_CHECKS" -eq "0" ]
@@ -0,0 +1,29 @@
+sp 		:= $(sp).x
+dirstack_$(sp)	:= $(d)
+d		:= $(dir)
+
+TGTS_$(d)	:= $(d)/check-breaker $(d)/check-hamming $(d)/check-ngram \
+		   $(d)/check-parallel $(d)/check-pool $(d)/check-search \
+		   $(d)/check-stream $(d)/check-wrapped
+DEPS_$(d)	:= $(TGTS_$(d):%=%.d)
+
+TGT_CHECK	:= $(TGT_CHECK) $(TGTS_$(d))
+CLEAN		:= $(CLEAN) $(TGTS_$(d)) $(DEPS_$(d))
+
+$(TGTS_$(d)):	$(d)/Rules.mk $(d)/src/check.h
+
+$(TGTS_$(d)):	CF_TGT := -Icommon/include
+$(TGTS_$(d)):	LF_TGT := -lcryptopal-common -Lcommon/
+$(TGTS_$(d)):	$(d)/check-%: $(d)/src/%.c common/libcryptopal-common.so
+		$(COMPLINK)
+
+# The Hamming distance check runs every kernel the CPU supports, which only the
+# library's internal header lists, and links the object with the hidden table
+$(d)/check-hamming:	CF_TGT := -Icommon/include -Icommon/src
+$(d)/check-hamming:	LL_TGT := common/src/utils_hamming.o
+$(d)/check-hamming:	common/src/utils_hamming.o
+
+-include	$(DEPS_$(d))
+
+d		:= $(dirstack_$(sp))
+sp		:= $(basename $(sp))
@@ -0,0 +1,83 @@
+/*
+ * The repeating XOR breaker recovers keys of every length with every scorer,
+ * both on the calling thread and on a pool, and decrypts the whole ciphertext
+ * with them.
+ */
+
+#include "check.h"
+
+#include <cryptopal-common.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BREAKER_CHECK_LEN 3000
+#define BREAKER_CHECK_MAX_KEY_LEN 37
+
+static void check_break_repeating_xor(const struct cpal_analysis_model *model,
+				      const uint8_t *plaintext,
+				      struct cpal_pool *pool)
+{
+	uint8_t ciphertext[BREAKER_CHECK_LEN];
+	uint8_t key[BREAKER_CHECK_MAX_KEY_LEN];
+
+	check_fill(key, sizeof(key), 3);
+
+	for (size_t key_len = 2; key_len <= sizeof(key); key_len += 5) {
+		struct cpal_analysis_key_score scores[3];
+
+		CHECK(cpal_cipher_xor_repeating_into(plaintext, sizeof(ciphertext),
+						     key, key_len,
+						     ciphertext) == 0);
+
+		int count = cpal_analysis_break_repeating_xor(
+		    model, ciphertext, sizeof(ciphertext), 2, 40, scores,
+		    CHECK_COUNT(scores), pool);
+
+		CHECK(count > 0);
+
+		if (count <= 0) {
+			continue;
+		}
+
+		CHECK(scores[0].key_len == key_len &&
+		      memcmp(scores[0].key, key, key_len) == 0);
+		CHECK(scores[0].decrypted_len == sizeof(ciphertext) &&
+		      memcmp(scores[0].decrypted, plaintext, sizeof(ciphertext)) ==
+			  0);
+
+		for (int i = 0; i < count; i++) {
+			free(scores[i].key);
+			free(scores[i].decrypted);
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	uint8_t plaintext[BREAKER_CHECK_LEN];
+	struct cpal_pool *pool;
+
+	(void)argc;
+	(void)argv;
+
+	if (cpal_pool_create(&pool, 3) < 0) {
+		return 1;
+	}
+
+	check_fill_english(plaintext, sizeof(plaintext), 7);
+
+	for (unsigned int scorer = CPAL_ANALYSIS_BHATTACHARYYA;
+	     scorer <= CPAL_ANALYSIS_LOG_LIKELIHOOD; scorer++) {
+		const struct cpal_analysis_model *model =
+		    cpal_analysis_english_model((enum cpal_analysis_scorer)scorer);
+
+		check_break_repeating_xor(model, plaintext, NULL);
+		check_break_repeating_xor(model, plaintext, pool);
+		printf("scorer %u\n", scorer);
+	}
+
+	cpal_pool_destroy(pool);
+	return check_status();
+}
@@ -0,0 +1,82 @@
+#ifndef CRYPTOPAL_CHECKS_CHECK_H
+#define CRYPTOPAL_CHECKS_CHECK_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * A failed check prints where it failed and counts towards the exit status, and
+ * checking carries on, so one run reports every failure.  Checks may fail on any
+ * thread.
+ */
+static atomic_uint check_failures;
+
+#define CHECK(cond)                                                                \
+	do {                                                                       \
+		if (!(cond)) {                                                     \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__,    \
+				__LINE__, #cond);                                  \
+			atomic_fetch_add(&check_failures, 1);                      \
+		}                                                                  \
+	} while (0)
+
+#define CHECK_COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+/**
+ * Fill @data with @len bytes which look random, the same ones every run.
+ */
+static inline void check_fill(uint8_t *data, const size_t len, uint32_t seed)
+{
+	for (size_t pos = 0; pos < len; pos++) {
+		seed = seed * 1103515245 + 12345;
+		data[pos] = seed >> 16;
+	}
+}
+
+/**
+ * Fill @data with @len bytes of English words in an order which looks random,
+ * the same one every run.
+ */
+static inline void check_fill_english(uint8_t *data, const size_t len,
+				      uint32_t seed)
+{
+	const char *words[] = {"the ",	 "quick ", "brown ", "fox ",    "jumps ",
+			       "over ",	 "lazy ",  "dog ",   "and ",    "then ",
+			       "I ",	 "said, ", "hello ", "world. ", "It ",
+			       "was ",	 "a ",	   "dark ",  "stormy ", "night\n"};
+	size_t count = CHECK_COUNT(words);
+	size_t pos = 0;
+
+	while (pos < len) {
+		seed = seed * 1103515245 + 12345;
+
+		const char *word = words[(seed >> 16) % count];
+		size_t word_len = strlen(word);
+
+		if (word_len > len - pos) {
+			word_len = len - pos;
+		}
+
+		memcpy(data + pos, word, word_len);
+		pos += word_len;
+	}
+}
+
+/**
+ * The exit status for the checks run so far.
+ */
+static inline int check_status(void)
+{
+	unsigned int failures = atomic_load(&check_failures);
+
+	if (failures > 0) {
+		fprintf(stderr, "%u checks failed\n", failures);
+	}
+
+	return failures > 0;
+}
+
+#endif
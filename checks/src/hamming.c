@@ -0,0 +1,120 @@
+/*
+ * Hamming distances: every kernel the CPU supports, not just the one selected
+ * for it, agrees with counting bit by bit at every length up to a few vectors and
+ * every misalignment, and pairwise matrices agree with it on and off a pool.
+ */
+
+#include "check.h"
+
+#include "utils_hamming_internal.h"
+
+#include <cryptopal-common.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define HAMMING_CHECK_MAX_LEN 700
+#define HAMMING_CHECK_LONG_LEN (1024 * 1024 + 5)
+
+static uint64_t hamming_reference(const uint8_t *a, const uint8_t *b,
+				  const size_t len)
+{
+	uint64_t distance = 0;
+
+	for (size_t pos = 0; pos < len; pos++) {
+		for (unsigned int bit = 0; bit < 8; bit++) {
+			distance += ((a[pos] ^ b[pos]) >> bit) & 1;
+		}
+	}
+
+	return distance;
+}
+
+static void check_kernel(const struct hamming_kernel_entry *entry,
+			 const uint8_t *a, const uint8_t *b)
+{
+	for (size_t len = 0; len <= HAMMING_CHECK_MAX_LEN; len++) {
+		for (size_t offset = 0; offset < 4; offset++) {
+			CHECK(entry->kernel(a + offset, b, len) ==
+			      hamming_reference(a + offset, b, len));
+		}
+	}
+
+	CHECK(entry->kernel(a, b + 1, HAMMING_CHECK_LONG_LEN) ==
+	      hamming_reference(a, b + 1, HAMMING_CHECK_LONG_LEN));
+}
+
+static void check_matrix(const uint8_t *blocks, struct cpal_pool *pool)
+{
+	const size_t block_lens[] = {1, 37, 256};
+	const size_t count = 150;
+	uint64_t *matrix = malloc(count * count * sizeof(*matrix));
+
+	if (matrix == NULL) {
+		CHECK(!"out of memory");
+		return;
+	}
+
+	for (size_t i = 0; i < CHECK_COUNT(block_lens); i++) {
+		size_t block_len = block_lens[i];
+
+		CHECK(cpal_hamming_distance_matrix(blocks, block_len, count, matrix,
+						   pool) == 0);
+
+		for (size_t row = 0; row < count; row++) {
+			for (size_t col = 0; col < count; col++) {
+				CHECK(matrix[row * count + col] ==
+				      hamming_reference(blocks + row * block_len,
+							blocks + col * block_len,
+							block_len));
+			}
+		}
+	}
+
+	free(matrix);
+}
+
+int main(int argc, char *argv[])
+{
+	uint8_t *a = malloc(HAMMING_CHECK_LONG_LEN + 4);
+	uint8_t *b = malloc(HAMMING_CHECK_LONG_LEN + 4);
+	struct cpal_pool *pool = NULL;
+
+	(void)argc;
+	(void)argv;
+
+	if (a == NULL || b == NULL || cpal_pool_create(&pool, 3) < 0) {
+		free(a);
+		free(b);
+		return 1;
+	}
+
+	check_fill(a, HAMMING_CHECK_LONG_LEN + 4, 1);
+	check_fill(b, HAMMING_CHECK_LONG_LEN + 4, 2);
+
+	for (size_t i = 0; i < hamming_kernel_count; i++) {
+		if (!hamming_kernels[i].supported()) {
+			printf("%s: not supported, skipped\n",
+			       hamming_kernels[i].name);
+			continue;
+		}
+
+		check_kernel(&hamming_kernels[i], a, b);
+		printf("%s\n", hamming_kernels[i].name);
+	}
+
+	// The kernel selected for the CPU, through the public entry point
+	for (size_t len = 0; len <= HAMMING_CHECK_MAX_LEN; len++) {
+		CHECK(cpal_hamming_distance(a, b, len) ==
+		      hamming_reference(a, b, len));
+	}
+
+	check_matrix(a, NULL);
+	check_matrix(a, pool);
+	printf("matrices\n");
+
+	cpal_pool_destroy(pool);
+	free(a);
+	free(b);
+	return check_status();
+}
@@ -0,0 +1,165 @@
+/*
+ * N-gram models: a model built from English words scores English above the same
+ * words scrambled and above noise, scoring through a XOR key matches scoring
+ * the plaintext, and opening rejects files which aren't models, or whose header
+ * is damaged.
+ */
+
+#include "check.h"
+
+#include <cryptopal-common.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NGRAM_CHECK_CORPUS_LEN 200000
+
+/**
+ * The offsets of the order and the fixed-point scale in a model file header.
+ */
+#define NGRAM_CHECK_ORDER_OFFSET 12
+#define NGRAM_CHECK_SCALE_OFFSET 24
+
+/**
+ * Overwrite the 32-bit header field at @offset of the model at @path with
+ * @value, and check that opening the model fails.
+ */
+static void check_damaged_header(const char *path, const off_t offset,
+				 const uint32_t value)
+{
+	struct cpal_ngram_model model;
+	uint32_t original;
+	int fd = open(path, O_RDWR);
+
+	if (fd < 0 || pread(fd, &original, sizeof(original), offset) < 0 ||
+	    pwrite(fd, &value, sizeof(value), offset) < 0) {
+		CHECK(!"damaging the model header");
+	} else {
+		CHECK(cpal_ngram_model_open(&model, path) == -EINVAL);
+		CHECK(pwrite(fd, &original, sizeof(original), offset) ==
+		      sizeof(original));
+	}
+
+	if (fd >= 0) {
+		close(fd);
+	}
+}
+
+static void check_order(const uint8_t *corpus, const char *path,
+			const unsigned int order)
+{
+	char english[] = "It was a dark and stormy night, said the fox";
+	char scrambled[] = "tI saw  krad dan mrotsy thgin, dias eht xof";
+	const uint8_t key[3] = {7, 99, 200};
+	struct cpal_ngram_model model;
+	uint8_t class_map[256];
+	uint8_t noise[300];
+	uint8_t *ciphertext;
+
+	unsigned int class_bits = cpal_ngram_english_classes(class_map);
+
+	CHECK(cpal_ngram_model_build(corpus, NGRAM_CHECK_CORPUS_LEN, class_map,
+				     class_bits, order, path) == 0);
+
+	if (cpal_ngram_model_open(&model, path) < 0) {
+		CHECK(!"cpal_ngram_model_open");
+		return;
+	}
+
+	check_fill(noise, sizeof(noise), order);
+
+	double english_score = cpal_ngram_model_score(
+	    &model, (const uint8_t *)english, strlen(english));
+	double scrambled_score = cpal_ngram_model_score(
+	    &model, (const uint8_t *)scrambled, strlen(scrambled));
+	double noise_score = cpal_ngram_model_score(&model, noise, sizeof(noise));
+
+	printf("order %u: english %f, scrambled %f, noise %f\n", order,
+	       english_score, scrambled_score, noise_score);
+
+	CHECK(english_score > noise_score);
+
+	// A unigram model can't tell words from their letters scrambled
+	if (order >= 2) {
+		CHECK(english_score > scrambled_score);
+		CHECK(scrambled_score > noise_score);
+	}
+
+	if (cpal_cipher_xor_repeating(corpus, 1000, key, sizeof(key),
+				      &ciphertext) == 0) {
+		double xor_score = cpal_ngram_model_score_xor(
+		    &model, ciphertext, 1000, key, sizeof(key));
+		double plain_score = cpal_ngram_model_score(&model, corpus, 1000);
+
+		CHECK(!(xor_score < plain_score) && !(xor_score > plain_score));
+		free(ciphertext);
+	}
+
+	struct cpal_analysis_key_score scores[3] = {
+	    {0.0, NULL, 0, noise, sizeof(noise)},
+	    {0.0, NULL, 0, (uint8_t *)english, strlen(english)},
+	    {0.0, NULL, 0, (uint8_t *)scrambled, strlen(scrambled)}};
+
+	cpal_ngram_model_rescore(&model, scores, 3);
+	CHECK(scores[0].decrypted == (uint8_t *)english);
+	CHECK(!(scores[0].score < scores[1].score) &&
+	      !(scores[1].score < scores[2].score));
+
+	cpal_ngram_model_close(&model);
+
+	check_damaged_header(path, NGRAM_CHECK_ORDER_OFFSET, 1U << 31);
+	check_damaged_header(path, NGRAM_CHECK_SCALE_OFFSET, 0);
+
+	// The damage was undone
+	CHECK(cpal_ngram_model_open(&model, path) == 0);
+	cpal_ngram_model_close(&model);
+}
+
+int main(int argc, char *argv[])
+{
+	char path[] = "/tmp/cpal-check-ngram-XXXXXX";
+	struct cpal_ngram_model model;
+	uint8_t class_map[256];
+
+	(void)argc;
+	(void)argv;
+
+	uint8_t *corpus = malloc(NGRAM_CHECK_CORPUS_LEN);
+	int fd = mkstemp(path);
+
+	if (corpus == NULL || fd < 0) {
+		free(corpus);
+		return 1;
+	}
+
+	close(fd);
+	check_fill_english(corpus, NGRAM_CHECK_CORPUS_LEN, 5);
+
+	for (unsigned int order = 1; order <= 4; order++) {
+		check_order(corpus, path, order);
+	}
+
+	// Too large a table, a corpus instead of a model, and no file at all
+	unsigned int class_bits = cpal_ngram_english_classes(class_map);
+
+	CHECK(cpal_ngram_model_build(corpus, NGRAM_CHECK_CORPUS_LEN, class_map,
+				     class_bits, 5, path) == -EINVAL);
+
+	fd = open(path, O_WRONLY | O_TRUNC);
+	CHECK(fd >= 0 && write(fd, corpus, 1000) == 1000);
+
+	if (fd >= 0) {
+		close(fd);
+	}
+
+	CHECK(cpal_ngram_model_open(&model, path) == -EINVAL);
+
+	unlink(path);
+	CHECK(cpal_ngram_model_open(&model, path) == -ENOENT);
+
+	free(corpus);
+	return check_status();
+}
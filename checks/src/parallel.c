@@ -0,0 +1,131 @@
+/*
+ * The multi-threaded RFC 4648 codecs: encoding and decoding on a pool, and on
+ * threads created for the call, gives exactly what the one-shot _into functions
+ * give, whether or not the input is large enough to be split.
+ */
+
+#include "check.h"
+
+#include <cryptopal-common.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct parallel_scheme {
+	const char *name;
+	int (*encode_into)(const uint8_t *input, const size_t input_size,
+			   char *output, size_t *output_size);
+	int (*decode_into)(const char *input, const size_t input_size,
+			   uint8_t *output, size_t *output_size);
+	size_t (*encoded_len)(const size_t input_size);
+	int (*encode_pool)(const uint8_t *input, const size_t input_size,
+			   char *output, size_t *output_size,
+			   struct cpal_pool *pool);
+	int (*decode_pool)(const char *input, const size_t input_size,
+			   uint8_t *output, size_t *output_size,
+			   struct cpal_pool *pool);
+	int (*encode_parallel)(const uint8_t *input, const size_t input_size,
+			       char *output, size_t *output_size,
+			       unsigned int threads);
+	int (*decode_parallel)(const char *input, const size_t input_size,
+			       uint8_t *output, size_t *output_size,
+			       unsigned int threads);
+};
+
+#define PARALLEL_SCHEME(name)                                                      \
+	{                                                                          \
+		#name, cpal_##name##_encode_into, cpal_##name##_decode_into,       \
+		    cpal_##name##_encoded_len, cpal_##name##_encode_pool,          \
+		    cpal_##name##_decode_pool, cpal_##name##_encode_parallel,      \
+		    cpal_##name##_decode_parallel                                  \
+	}
+
+static const struct parallel_scheme parallel_schemes[] = {
+    PARALLEL_SCHEME(base16), PARALLEL_SCHEME(base32), PARALLEL_SCHEME(base32hex),
+    PARALLEL_SCHEME(base64), PARALLEL_SCHEME(base64safe),
+};
+
+/**
+ * Lengths too small to split, and one long enough to be split into slices for
+ * more than one thread, which doesn't end on a group boundary.
+ */
+static const size_t parallel_lens[] = {0, 1, 2, 3, 4, 5, 39, 40, 41, 1000003};
+
+static void check_scheme(const struct parallel_scheme *scheme, const uint8_t *raw,
+			 const size_t len, struct cpal_pool *pool)
+{
+	size_t capacity = scheme->encoded_len(len);
+	char *encoded = malloc(capacity + 1);
+	char *other = malloc(capacity + 1);
+	uint8_t *decoded = malloc(len + 1);
+	size_t encoded_len = capacity;
+	size_t other_len;
+	size_t decoded_len;
+
+	if (encoded == NULL || other == NULL || decoded == NULL) {
+		CHECK(!"out of memory");
+		goto exit;
+	}
+
+	CHECK(scheme->encode_into(raw, len, encoded, &encoded_len) == 0);
+
+	other_len = capacity;
+	CHECK(scheme->encode_pool(raw, len, other, &other_len, pool) == 0);
+	CHECK(other_len == encoded_len && memcmp(other, encoded, encoded_len) == 0);
+
+	other_len = capacity;
+	CHECK(scheme->encode_parallel(raw, len, other, &other_len, 3) == 0);
+	CHECK(other_len == encoded_len && memcmp(other, encoded, encoded_len) == 0);
+
+	decoded_len = len + 1;
+	CHECK(scheme->decode_into(encoded, encoded_len, decoded, &decoded_len) ==
+	      0);
+	CHECK(decoded_len == len && memcmp(decoded, raw, len) == 0);
+
+	decoded_len = len + 1;
+	CHECK(scheme->decode_pool(encoded, encoded_len, decoded, &decoded_len,
+				  pool) == 0);
+	CHECK(decoded_len == len && memcmp(decoded, raw, len) == 0);
+
+	decoded_len = len + 1;
+	CHECK(scheme->decode_parallel(encoded, encoded_len, decoded, &decoded_len,
+				      3) == 0);
+	CHECK(decoded_len == len && memcmp(decoded, raw, len) == 0);
+exit:
+	free(encoded);
+	free(other);
+	free(decoded);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t max_len = parallel_lens[CHECK_COUNT(parallel_lens) - 1];
+	uint8_t *raw = malloc(max_len);
+	struct cpal_pool *pool;
+
+	(void)argc;
+	(void)argv;
+
+	if (raw == NULL || cpal_pool_create(&pool, 4) < 0) {
+		free(raw);
+		return 1;
+	}
+
+	check_fill(raw, max_len, 1);
+
+	for (size_t scheme = 0; scheme < CHECK_COUNT(parallel_schemes); scheme++) {
+		for (size_t i = 0; i < CHECK_COUNT(parallel_lens); i++) {
+			check_scheme(&parallel_schemes[scheme], raw,
+				     parallel_lens[i], pool);
+			check_scheme(&parallel_schemes[scheme], raw,
+				     parallel_lens[i], NULL);
+		}
+
+		printf("%s\n", parallel_schemes[scheme].name);
+	}
+
+	cpal_pool_destroy(pool);
+	free(raw);
+	return check_status();
+}
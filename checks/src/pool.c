@@ -0,0 +1,150 @@
+/*
+ * The thread pool: every index of a parallel loop is visited exactly once,
+ * including from loops nested in other loops, tasks submitted by tasks all run
+ * before a join returns, and tasks still queued when a pool is destroyed still
+ * run.  Worth running under ThreadSanitizer.
+ */
+
+#include "check.h"
+
+#include <cryptopal-common.h>
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+struct pool_check {
+	struct cpal_pool *pool;
+	atomic_ulong total;
+	atomic_ulong visits[10000];
+};
+
+static void pool_check_range(void *arg, size_t begin, size_t end)
+{
+	struct pool_check *check = arg;
+	unsigned long sum = 0;
+
+	for (size_t i = begin; i < end; i++) {
+		sum += i;
+	}
+
+	atomic_fetch_add(&check->total, sum);
+}
+
+static void pool_check_visit(void *arg, size_t begin, size_t end)
+{
+	struct pool_check *check = arg;
+
+	for (size_t i = begin; i < end; i++) {
+		atomic_fetch_add(&check->visits[i], 1);
+	}
+}
+
+static void pool_check_nested(void *arg, size_t begin, size_t end)
+{
+	struct pool_check *check = arg;
+
+	for (size_t i = begin; i < end; i++) {
+		cpal_pool_parallel_for(check->pool, 0, 1000, 7, pool_check_range,
+				       check);
+	}
+}
+
+static void pool_check_leaf(void *arg)
+{
+	struct pool_check *check = arg;
+
+	atomic_fetch_add(&check->total, 1);
+}
+
+static void pool_check_spawner(void *arg)
+{
+	struct pool_check *check = arg;
+
+	for (size_t i = 0; i < 100; i++) {
+		CHECK(cpal_pool_submit(check->pool, pool_check_leaf, check) == 0);
+	}
+}
+
+static void check_pool(struct pool_check *check, struct cpal_pool *pool)
+{
+	check->pool = pool;
+
+	atomic_store(&check->total, 0);
+	cpal_pool_parallel_for(pool, 0, 1000000, 100, pool_check_range, check);
+	CHECK(atomic_load(&check->total) == 499999500000UL);
+
+	for (size_t i = 0; i < 10000; i++) {
+		atomic_store(&check->visits[i], 0);
+	}
+
+	cpal_pool_parallel_for(pool, 0, 10000, 3, pool_check_visit, check);
+
+	for (size_t i = 0; i < 10000; i++) {
+		CHECK(atomic_load(&check->visits[i]) == 1);
+	}
+
+	// Loops nested in the bodies of other loops
+	atomic_store(&check->total, 0);
+	cpal_pool_parallel_for(pool, 0, 50, 1, pool_check_nested, check);
+	CHECK(atomic_load(&check->total) == 50UL * 499500);
+
+	// Tasks submitting tasks while the pool is joined
+	atomic_store(&check->total, 0);
+
+	for (size_t i = 0; i < 100; i++) {
+		CHECK(cpal_pool_submit(pool, pool_check_spawner, check) == 0);
+	}
+
+	cpal_pool_join(pool);
+	CHECK(atomic_load(&check->total) == 10000);
+
+	// An empty loop doesn't call the body at all
+	atomic_store(&check->total, 1);
+	cpal_pool_parallel_for(pool, 5, 5, 1, pool_check_range, check);
+	CHECK(atomic_load(&check->total) == 1);
+}
+
+int main(int argc, char *argv[])
+{
+	static struct pool_check check;
+	const unsigned int threads[] = {1, 2, 8, 0};
+	struct cpal_pool *pool;
+
+	(void)argc;
+	(void)argv;
+
+	for (size_t i = 0; i < CHECK_COUNT(threads); i++) {
+		int err = cpal_pool_create(&pool, threads[i]);
+
+		CHECK(err == 0);
+		if (err < 0) {
+			continue;
+		}
+
+		CHECK(threads[i] == 0 || cpal_pool_threads(pool) == threads[i]);
+		printf("pool of %u threads\n", cpal_pool_threads(pool));
+		check_pool(&check, pool);
+
+		// Tasks still queued when the pool is destroyed
+		atomic_store(&check.total, 0);
+
+		for (size_t task = 0; task < 100; task++) {
+			CHECK(cpal_pool_submit(pool, pool_check_leaf, &check) == 0);
+		}
+
+		cpal_pool_destroy(pool);
+		CHECK(atomic_load(&check.total) == 100);
+	}
+
+	// A NULL pool runs everything on the calling thread, right away
+	check_pool(&check, NULL);
+	CHECK(cpal_pool_threads(NULL) == 1);
+
+	atomic_store(&check.total, 0);
+	CHECK(cpal_pool_submit(NULL, pool_check_leaf, &check) == 0);
+	CHECK(atomic_load(&check.total) == 1);
+	cpal_pool_destroy(NULL);
+	printf("NULL pool\n");
+
+	return check_status();
+}
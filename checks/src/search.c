@@ -0,0 +1,164 @@
+/*
+ * Pruned key searches: pruning on score alone keeps exactly the keys the
+ * unpruned search keeps with every scorer, including past the length at which
+ * chi-squared sums move to doubles, and pruning on the printable ratio still
+ * keeps the right key.
+ */
+
+#include "check.h"
+
+#include <cryptopal-common.h>
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SEARCH_CHECK_MAX_LEN 600000
+#define SEARCH_CHECK_KEY_LEN 3
+#define SEARCH_CHECK_KEYS 64
+#define SEARCH_CHECK_RIGHT_KEY 40
+
+static const uint8_t search_check_key[SEARCH_CHECK_KEY_LEN] = {0x5a, 0x13, 0xc7};
+
+static void check_search(const struct cpal_analysis_model *model,
+			 const uint8_t *ciphertext, const size_t len,
+			 const uint8_t *keys, const size_t key_count,
+			 const size_t capacity)
+{
+	struct cpal_analysis_top_entry full_entries[SEARCH_CHECK_KEYS];
+	struct cpal_analysis_top_entry pruned_entries[SEARCH_CHECK_KEYS];
+	struct cpal_analysis_top full;
+	struct cpal_analysis_top pruned;
+
+	cpal_analysis_top_init(&full, full_entries, capacity);
+	cpal_analysis_top_init(&pruned, pruned_entries, capacity);
+
+	CHECK(cpal_analysis_search_xor(model, ciphertext, len, keys,
+				       SEARCH_CHECK_KEY_LEN, key_count, 0,
+				       &full) == 0);
+	CHECK(cpal_analysis_search_xor_pruned(model, ciphertext, len, keys,
+					      SEARCH_CHECK_KEY_LEN, key_count, 0,
+					      &pruned, 0.0) >= 0);
+
+	cpal_analysis_top_sort(&full);
+	cpal_analysis_top_sort(&pruned);
+
+	CHECK(full.len == pruned.len);
+	CHECK(memcmp(full_entries, pruned_entries,
+		     full.len * sizeof(full_entries[0])) == 0);
+
+	for (size_t i = 0; i < full.len; i++) {
+		double score = cpal_analysis_score_xor(
+		    model, ciphertext, len,
+		    keys + full_entries[i].key * SEARCH_CHECK_KEY_LEN,
+		    SEARCH_CHECK_KEY_LEN);
+
+		CHECK(!(score < full_entries[i].score) &&
+		      !(score > full_entries[i].score));
+	}
+
+	// The right key is made of nothing but printable bytes
+	cpal_analysis_top_init(&pruned, pruned_entries, capacity);
+	CHECK(cpal_analysis_search_xor_pruned(model, ciphertext, len, keys,
+					      SEARCH_CHECK_KEY_LEN, key_count, 0,
+					      &pruned, 0.9) > 0);
+	cpal_analysis_top_sort(&pruned);
+	CHECK(pruned.len > 0 && pruned_entries[0].key == SEARCH_CHECK_RIGHT_KEY);
+}
+
+/**
+ * Plaintexts of a single repeated byte, long enough that the last check before
+ * the end sees a count whose square times the weight of the byte overflows 64
+ * bits.  A key giving a byte a little less likely than the byte of the key kept
+ * can only be dropped at that check, and only if its bound is still exact.
+ */
+static void check_chi_squared_overflow(void)
+{
+	const size_t len = ((size_t)1 << 20) + ((size_t)1 << 17);
+	const uint8_t keys[2] = {0x02, 0x01};
+	struct cpal_analysis_top_entry entries[1];
+	struct cpal_analysis_model model;
+	struct cpal_analysis_top top;
+	double table[256] = {0.0};
+
+	uint8_t *ciphertext = calloc(len, 1);
+
+	if (ciphertext == NULL) {
+		CHECK(!"out of memory");
+		return;
+	}
+
+	table['a'] = 1.0;
+	table[0x02] = 2e-5;
+	cpal_analysis_model_init_scorer(&model, table, CPAL_ANALYSIS_CHI_SQUARED);
+
+	cpal_analysis_top_init(&top, entries, 1);
+	CHECK(cpal_analysis_search_xor_pruned(&model, ciphertext, len, keys, 1, 2,
+					      0, &top, 0.0) == 1);
+	CHECK(top.len == 1 && entries[0].key == 0);
+
+	free(ciphertext);
+}
+
+int main(int argc, char *argv[])
+{
+	const size_t lens[] = {64, 100, 4096, SEARCH_CHECK_MAX_LEN};
+	uint8_t keys[SEARCH_CHECK_KEYS * SEARCH_CHECK_KEY_LEN];
+
+	(void)argc;
+	(void)argv;
+
+	uint8_t *plaintext = malloc(SEARCH_CHECK_MAX_LEN);
+	uint8_t *ciphertext = malloc(SEARCH_CHECK_MAX_LEN);
+
+	if (plaintext == NULL || ciphertext == NULL) {
+		free(plaintext);
+		free(ciphertext);
+		return 1;
+	}
+
+	check_fill_english(plaintext, SEARCH_CHECK_MAX_LEN, 7);
+	CHECK(cpal_cipher_xor_repeating_into(plaintext, SEARCH_CHECK_MAX_LEN,
+					     search_check_key, SEARCH_CHECK_KEY_LEN,
+					     ciphertext) == 0);
+
+	check_fill(keys, sizeof(keys), 11);
+	memcpy(keys + SEARCH_CHECK_RIGHT_KEY * SEARCH_CHECK_KEY_LEN,
+	       search_check_key, SEARCH_CHECK_KEY_LEN);
+
+	for (unsigned int scorer = CPAL_ANALYSIS_BHATTACHARYYA;
+	     scorer <= CPAL_ANALYSIS_LOG_LIKELIHOOD; scorer++) {
+		const struct cpal_analysis_model *model =
+		    cpal_analysis_english_model((enum cpal_analysis_scorer)scorer);
+
+		for (size_t i = 0; i < CHECK_COUNT(lens); i++) {
+			check_search(model, ciphertext, lens[i], keys,
+				     SEARCH_CHECK_KEYS, 1);
+			check_search(model, ciphertext, lens[i], keys,
+				     SEARCH_CHECK_KEYS, 5);
+		}
+
+		printf("scorer %u\n", scorer);
+	}
+
+	check_chi_squared_overflow();
+
+	// Printable ratios outside 0 to 1
+	const double bad_ratios[] = {-0.1, 1.5, NAN};
+	struct cpal_analysis_top_entry entries[1];
+	struct cpal_analysis_top top;
+
+	cpal_analysis_top_init(&top, entries, 1);
+
+	for (size_t i = 0; i < CHECK_COUNT(bad_ratios); i++) {
+		CHECK(cpal_analysis_search_xor_pruned(
+			  cpal_analysis_english_model(CPAL_ANALYSIS_LOG_LIKELIHOOD),
+			  ciphertext, 64, keys, SEARCH_CHECK_KEY_LEN, 1, 0, &top,
+			  bad_ratios[i]) == -EINVAL);
+	}
+
+	free(plaintext);
+	free(ciphertext);
+	return check_status();
+}
@@ -0,0 +1,146 @@
+/*
+ * The streaming RFC 4648 contexts: encoding and decoding fed in chunks of every
+ * awkward size gives exactly what the one-shot _into functions give.
+ */
+
+#include "check.h"
+
+#include <cryptopal-common.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct stream_scheme {
+	const char *name;
+	int (*encode_into)(const uint8_t *input, const size_t input_size,
+			   char *output, size_t *output_size);
+	size_t (*encoded_len)(const size_t input_size);
+	void (*encoder_init)(struct cpal_rfc4648_encoder *encoder);
+	void (*decoder_init)(struct cpal_rfc4648_decoder *decoder);
+};
+
+#define STREAM_SCHEME(name)                                                        \
+	{                                                                          \
+		#name, cpal_##name##_encode_into, cpal_##name##_encoded_len,       \
+		    cpal_##name##_encoder_init, cpal_##name##_decoder_init         \
+	}
+
+static const struct stream_scheme stream_schemes[] = {
+    STREAM_SCHEME(base16), STREAM_SCHEME(base32), STREAM_SCHEME(base32hex),
+    STREAM_SCHEME(base64), STREAM_SCHEME(base64safe),
+};
+
+/**
+ * Lengths around every group size, and one spanning many chunks of each size.
+ */
+static const size_t stream_lens[] = {0, 1, 2, 3, 4, 5, 6, 7, 39, 40, 41, 100003};
+
+static const size_t stream_chunks[] = {1, 3, 7, 64, 4099};
+
+static void check_stream(const struct stream_scheme *scheme, const uint8_t *raw,
+			 const size_t len, const char *encoded,
+			 const size_t encoded_len, const size_t chunk)
+{
+	struct cpal_rfc4648_encoder encoder;
+	struct cpal_rfc4648_decoder decoder;
+	char *streamed = malloc(encoded_len + CPAL_RFC4648_MAX_GROUP_CHARS + 1);
+	uint8_t *decoded = malloc(len + CPAL_RFC4648_MAX_GROUP_BYTES + 1);
+	size_t streamed_len = 0;
+	size_t decoded_len = 0;
+	size_t out_len;
+
+	if (streamed == NULL || decoded == NULL) {
+		CHECK(!"out of memory");
+		goto exit;
+	}
+
+	scheme->encoder_init(&encoder);
+
+	for (size_t pos = 0; pos < len; pos += chunk) {
+		size_t chunk_len = len - pos < chunk ? len - pos : chunk;
+
+		out_len = cpal_rfc4648_encoder_max_output(&encoder, chunk_len);
+		CHECK(cpal_rfc4648_encoder_update(&encoder, raw + pos, chunk_len,
+						  streamed + streamed_len,
+						  &out_len) == 0);
+		streamed_len += out_len;
+	}
+
+	out_len = CPAL_RFC4648_MAX_GROUP_CHARS;
+	CHECK(cpal_rfc4648_encoder_finalize(&encoder, streamed + streamed_len,
+					    &out_len) == 0);
+	streamed_len += out_len;
+
+	CHECK(streamed_len == encoded_len);
+	CHECK(memcmp(streamed, encoded, encoded_len) == 0);
+
+	scheme->decoder_init(&decoder);
+
+	for (size_t pos = 0; pos < encoded_len; pos += chunk) {
+		size_t chunk_len =
+		    encoded_len - pos < chunk ? encoded_len - pos : chunk;
+
+		out_len = cpal_rfc4648_decoder_max_output(&decoder, chunk_len);
+		CHECK(cpal_rfc4648_decoder_update(&decoder, encoded + pos,
+						  chunk_len, decoded + decoded_len,
+						  &out_len) == 0);
+		decoded_len += out_len;
+	}
+
+	out_len = CPAL_RFC4648_MAX_GROUP_BYTES;
+	CHECK(cpal_rfc4648_decoder_finalize(&decoder, decoded + decoded_len,
+					    &out_len) == 0);
+	decoded_len += out_len;
+
+	CHECK(decoded_len == len);
+	CHECK(memcmp(decoded, raw, len) == 0);
+exit:
+	free(streamed);
+	free(decoded);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t max_len = stream_lens[CHECK_COUNT(stream_lens) - 1];
+	uint8_t *raw = malloc(max_len);
+
+	(void)argc;
+	(void)argv;
+
+	if (raw == NULL) {
+		return 1;
+	}
+
+	check_fill(raw, max_len, 1);
+
+	for (size_t scheme = 0; scheme < CHECK_COUNT(stream_schemes); scheme++) {
+		const struct stream_scheme *s = &stream_schemes[scheme];
+
+		for (size_t i = 0; i < CHECK_COUNT(stream_lens); i++) {
+			size_t encoded_len = s->encoded_len(stream_lens[i]);
+			char *encoded = malloc(encoded_len + 1);
+
+			if (encoded == NULL) {
+				CHECK(!"out of memory");
+				continue;
+			}
+
+			CHECK(s->encode_into(raw, stream_lens[i], encoded,
+					     &encoded_len) == 0);
+
+			for (size_t chunk = 0; chunk < CHECK_COUNT(stream_chunks);
+			     chunk++) {
+				check_stream(s, raw, stream_lens[i], encoded,
+					     encoded_len, stream_chunks[chunk]);
+			}
+
+			free(encoded);
+		}
+
+		printf("%s\n", s->name);
+	}
+
+	free(raw);
+	return check_status();
+}
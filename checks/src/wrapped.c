@@ -0,0 +1,105 @@
+/*
+ * Line-wrapped base64: every line break lands right after a full line, and the
+ * wrapped text decodes back to what was encoded, including when the lines are
+ * indented or end in CRLF.
+ */
+
+#include "check.h"
+
+#include <cryptopal-common.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const size_t wrapped_lens[] = {0, 1, 2, 3, 4, 5, 39, 40, 41, 57, 100003};
+
+static const size_t wrapped_line_lens[] = {0, 4, 64, 76};
+
+static void check_wrapped(const uint8_t *raw, const size_t len,
+			  const size_t line_len)
+{
+	size_t capacity = cpal_base64_encoded_wrapped_len(len, line_len);
+	size_t decoded_capacity = cpal_base64_decoded_wrapped_len(2 * capacity);
+	char *encoded = malloc(capacity + 1);
+	char *spaced = malloc(2 * capacity + 1);
+	uint8_t *decoded = malloc(decoded_capacity);
+	size_t encoded_len = capacity;
+	size_t spaced_len = 0;
+	size_t decoded_len;
+
+	if (encoded == NULL || spaced == NULL || decoded == NULL) {
+		CHECK(!"out of memory");
+		goto exit;
+	}
+
+	CHECK(cpal_base64_encode_wrapped_into(raw, len, line_len, encoded,
+					      &encoded_len) == 0);
+	CHECK(encoded_len == capacity);
+
+	for (size_t pos = 0; line_len > 0 && pos < encoded_len; pos++) {
+		CHECK((encoded[pos] == '\n') == (pos % (line_len + 1) == line_len));
+	}
+
+	decoded_len = decoded_capacity;
+	CHECK(cpal_base64_decode_wrapped_into(encoded, encoded_len, decoded,
+					      &decoded_len) == 0);
+	CHECK(decoded_len == len && memcmp(decoded, raw, len) == 0);
+
+	// Indent every line with a tab and end it with CRLF instead
+	for (size_t pos = 0; pos < encoded_len; pos++) {
+		if (pos == 0 || encoded[pos - 1] == '\n') {
+			spaced[spaced_len++] = '\t';
+		}
+
+		if (encoded[pos] == '\n') {
+			spaced[spaced_len++] = '\r';
+		}
+
+		spaced[spaced_len++] = encoded[pos];
+	}
+
+	decoded_len = decoded_capacity;
+	CHECK(cpal_base64_decode_wrapped_into(spaced, spaced_len, decoded,
+					      &decoded_len) == 0);
+	CHECK(decoded_len == len && memcmp(decoded, raw, len) == 0);
+
+	// Anything else between the lines is rejected
+	if (line_len > 0 && len > line_len) {
+		encoded[line_len] = '.';
+		decoded_len = decoded_capacity;
+		CHECK(cpal_base64_decode_wrapped_into(encoded, encoded_len, decoded,
+						      &decoded_len) == -EINVAL);
+	}
+exit:
+	free(encoded);
+	free(spaced);
+	free(decoded);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t max_len = wrapped_lens[CHECK_COUNT(wrapped_lens) - 1];
+	uint8_t *raw = malloc(max_len);
+
+	(void)argc;
+	(void)argv;
+
+	if (raw == NULL) {
+		return 1;
+	}
+
+	check_fill(raw, max_len, 2);
+
+	for (size_t i = 0; i < CHECK_COUNT(wrapped_line_lens); i++) {
+		for (size_t j = 0; j < CHECK_COUNT(wrapped_lens); j++) {
+			check_wrapped(raw, wrapped_lens[j], wrapped_line_lens[i]);
+		}
+
+		printf("line length %zu\n", wrapped_line_lens[i]);
+	}
+
+	free(raw);
+	return check_status();
+}
@@ -3,15 +3,30 @@ dirstack_$(sp)	:= $(d)
 d		:= $(dir)
 
 OBJS_$(d)	:= $(d)/src/rfc4648_encoding.o $(d)/src/cipher_xor.o \
-		   $(d)/src/utils_analysis.o $(d)/src/utils_string.o
+		   $(d)/src/utils_analysis.o $(d)/src/utils_string.o \
+		   $(d)/src/rfc4648_base64_simd.o $(d)/src/rfc4648_base16_simd.o \
+		   $(d)/src/rfc4648_base32_simd.o $(d)/src/rfc4648_stream.o \
+		   $(d)/src/rfc4648_parallel.o $(d)/src/rfc4648_wrapped.o \
+		   $(d)/src/cipher_xor_simd.o $(d)/src/cipher_xor_stream.o \
+		   $(d)/src/utils_arena.o $(d)/src/utils_pool.o \
+		   $(d)/src/utils_hamming.o $(d)/src/utils_search.o \
+		   $(d)/src/utils_ngram.o
+KERNELS_$(d)	:= $(d)/src/rfc4648_base64_simd.o $(d)/src/rfc4648_base16_simd.o \
+		   $(d)/src/rfc4648_base32_simd.o $(d)/src/rfc4648_wrapped.o \
+		   $(d)/src/cipher_xor_simd.o $(d)/src/utils_hamming.o \
+		   $(d)/src/utils_search.o
 DEPS_$(d)	:= $(OBJS_$(d):%=%.d)
 
 CLEAN		:= $(CLEAN) $(OBJS_$(d)) $(DEPS_$(d)) \
 		   $(d)/libcryptopal-common.so
 
 $(OBJS_$(d)):	CF_TGT := -I$(d)/include -fPIC
+# The SIMD kernels (and the whitespace scan feeding them wrapped input) are
+# only worth dispatching to when they are optimized, as are the fused key
+# searches, which rely on their steps being inlined
+$(KERNELS_$(d)):	CF_TGT := -I$(d)/include -fPIC -O3
 $(d)/libcryptopal-common.so: $(OBJS_$(d))
-	$(CC) ${LDFLAGS} -o $@ $^ -shared
+	$(CC) ${LDFLAGS} -o $@ $^ -shared -pthread
 
 -include	$(DEPS_$(d))
 
@@ -4,6 +4,134 @@
 #include <stdint.h>
 #include <stddef.h>
 
+/**
+ * The size of the blocks an arena allocates from when it is initialized with a
+ * @block_size of 0.
+ */
+#define CPAL_ARENA_DEFAULT_BLOCK_SIZE 65536
+
+struct cpal_arena_block;
+
+/**
+ * A bump allocator for buffers which share a lifetime, such as the results of a
+ * key search.  Allocations are carved from large blocks and can't be freed on
+ * their own; instead the whole arena is reset for reuse or freed at once.  The
+ * members are private to the library; initialize the arena with
+ * @cpal_arena_init.  An arena must not be shared between threads.
+ */
+struct cpal_arena {
+	struct cpal_arena_block *head;
+	struct cpal_arena_block *current;
+	size_t block_size;
+};
+
+/**
+ * Initialize an empty @arena.  No memory is allocated until the first call to
+ * @cpal_arena_alloc.
+ *
+ * @block_size The size of the blocks to allocate, or 0 for the default.
+ */
+void cpal_arena_init(struct cpal_arena *arena, const size_t block_size);
+
+/**
+ * Allocate @size bytes from @arena, aligned for any type.  Requests larger than
+ * the block size get a block of their own.
+ *
+ * @return The allocated memory, or NULL if out of memory.
+ */
+void *cpal_arena_alloc(struct cpal_arena *arena, const size_t size);
+
+/**
+ * Release everything allocated from @arena at once, keeping its blocks to be
+ * handed out again by later calls to @cpal_arena_alloc.
+ */
+void cpal_arena_reset(struct cpal_arena *arena);
+
+/**
+ * Free the blocks of @arena, and with them everything allocated from it.  The
+ * arena is left empty and may be used again.
+ */
+void cpal_arena_free(struct cpal_arena *arena);
+
+struct cpal_pool;
+
+/**
+ * A task callback for @cpal_pool_submit.
+ */
+typedef void (*cpal_pool_task_fn)(void *arg);
+
+/**
+ * A loop body callback for @cpal_pool_parallel_for, which handles the indices
+ * from @begin up to @end.
+ */
+typedef void (*cpal_pool_range_fn)(void *arg, size_t begin, size_t end);
+
+/**
+ * Create a work-stealing thread pool of @threads threads, or one per online CPU
+ * if @threads is 0.  The thread waiting on the pool in @cpal_pool_join or
+ * @cpal_pool_parallel_for is one of them, so @threads - 1 workers are started.
+ *
+ * @return 0 if successful, -ENOMEM if out of memory, or -EAGAIN if the workers
+ * could not be started.
+ */
+int cpal_pool_create(struct cpal_pool **pool, unsigned int threads);
+
+/**
+ * Run any tasks still queued on @pool, then stop its workers and free it.
+ */
+void cpal_pool_destroy(struct cpal_pool *pool);
+
+/**
+ * Return the number of threads @pool runs tasks on, or 1 for a NULL pool.
+ */
+unsigned int cpal_pool_threads(const struct cpal_pool *pool);
+
+/**
+ * Queue @fn to be called with @arg on one of the threads of @pool.  Tasks may
+ * submit further tasks.  A pool of a single thread only runs them in
+ * @cpal_pool_join, and a NULL pool runs @fn right away on the calling thread.
+ *
+ * @return 0 if successful, or -ENOMEM if out of memory.
+ */
+int cpal_pool_submit(struct cpal_pool *pool, cpal_pool_task_fn fn, void *arg);
+
+/**
+ * Wait for every task submitted to @pool, including any submitted while waiting,
+ * to finish.  The calling thread runs queued tasks in the meantime.  Returns
+ * at once for a NULL pool, whose tasks have all run in @cpal_pool_submit.
+ */
+void cpal_pool_join(struct cpal_pool *pool);
+
+/**
+ * Call @fn on ranges covering the indices from @begin up to @end, spread over
+ * the threads of @pool, and wait for all of them to finish.  Ranges are split
+ * down to @grain indices at the smallest, and idle threads steal the largest
+ * ranges left.  It may be called from within a task or another parallel for.
+ * With a NULL @pool, @fn is called once with the whole range.
+ */
+void cpal_pool_parallel_for(struct cpal_pool *pool, const size_t begin,
+			    const size_t end, const size_t grain,
+			    cpal_pool_range_fn fn, void *arg);
+
+/**
+ * A view of @count bytes starting at @base, each @stride bytes after the last,
+ * such as one column of a ciphertext encrypted with a repeating key.  Views
+ * never copy the bytes they cover.
+ */
+struct cpal_strided_view {
+	const uint8_t *base;
+	size_t stride;
+	size_t count;
+};
+
+/**
+ * Initialize @view as column @column of the @len bytes of @data laid out in rows
+ * of @columns bytes: every byte whose offset is @column modulo @columns.
+ */
+void cpal_strided_view_init_column(struct cpal_strided_view *view,
+				   const uint8_t *data, const size_t len,
+				   const size_t columns, const size_t column);
+
 /**
  * Representation of a key score and plaintext result from @cpal_analysis_try_keys.
  */
@@ -60,6 +188,37 @@ int cpal_analysis_try_key(const uint8_t *ciphertext, const size_t len,
 			  cpal_analysis_score_fn score_fn,
 			  cpal_analysis_decrypt_fn decrypt_fn);
 
+/**
+ * A decrypt function callback like @cpal_analysis_decrypt_fn, but which writes
+ * the result to a caller supplied buffer instead of allocating one.
+ *
+ * @output [out] The location to store the result in.
+ * @output_len [in,out] The capacity of @output, updated with the length of the
+ * result.
+ *
+ * @return 0 if successful, -ENOSPC if @output is too small, or another negative
+ * value indicating failure.
+ */
+typedef int (*cpal_analysis_decrypt_into_fn)(const uint8_t *key, size_t key_len,
+					     const uint8_t *ciphertext, size_t len,
+					     uint8_t *output, size_t *output_len);
+
+/**
+ * Like @cpal_analysis_try_key, but the key copy and the decrypted text stored in
+ * @score are allocated from @arena, giving room for a plaintext as long as the
+ * ciphertext.  They must not be free()'d, and stay valid until @arena is reset
+ * or freed.
+ *
+ * @return 0 if successful, -ENOMEM if @arena is out of memory, or the error
+ * from @decrypt_fn.
+ */
+int cpal_analysis_try_key_arena(const uint8_t *ciphertext, const size_t len,
+				const uint8_t *key, const size_t key_len,
+				struct cpal_analysis_key_score *score,
+				cpal_analysis_score_fn score_fn,
+				cpal_analysis_decrypt_into_fn decrypt_fn,
+				struct cpal_arena *arena);
+
 /**
  * Score a decrypted ciphertext using the statistical distance of the character
  * probabilities in the given @table from the actual frequency of characters in
@@ -73,6 +232,429 @@ double cpal_analysis_bhattacharyya_score(const double table[256],
 					 const uint8_t *decrypted,
 					 const size_t decrypted_len);
 
+/**
+ * The statistics a @cpal_analysis_model can score plaintexts with.  Higher
+ * scores are better for all of them, but scores from different scorers can't be
+ * compared with each other.
+ *
+ * CPAL_ANALYSIS_BHATTACHARYYA: The Bhattacharyya coefficient between the table
+ * and the plaintext's byte frequencies, as @cpal_analysis_bhattacharyya_score.
+ * CPAL_ANALYSIS_CHI_SQUARED: The negated chi-squared statistic of the plaintext's
+ * byte counts against the table, divided by the plaintext length, so that a
+ * plaintext matching the table exactly scores 0 and every other scores below it.
+ * CPAL_ANALYSIS_LOG_LIKELIHOOD: The mean natural log of the table's probability
+ * of each plaintext byte.
+ */
+enum cpal_analysis_scorer {
+	CPAL_ANALYSIS_BHATTACHARYYA,
+	CPAL_ANALYSIS_CHI_SQUARED,
+	CPAL_ANALYSIS_LOG_LIKELIHOOD,
+};
+
+/**
+ * A character probability table prepared for scoring many plaintexts, so that
+ * the per-character work of a @scorer is only done once.  The chi-squared and
+ * log-likelihood scorers weigh each byte value with a fixed-point integer in
+ * @weights, so scoring a plaintext is an integer dot product of the weights with
+ * its byte counts.  The sum of the table and the largest weight are kept to bound
+ * the scores of partly scored plaintexts.  Initialize it with
+ * @cpal_analysis_model_init or @cpal_analysis_model_init_scorer.
+ */
+struct cpal_analysis_model {
+	enum cpal_analysis_scorer scorer;
+	double sqrt_probabilities[256];
+	double total_probability;
+	int32_t weights[256];
+	int32_t max_weight;
+};
+
+/**
+ * Prepare @model for scoring plaintexts against the character probabilities in
+ * @table, with the Bhattacharyya coefficient.
+ */
+void cpal_analysis_model_init(struct cpal_analysis_model *model,
+			      const double table[256]);
+
+/**
+ * Prepare @model for scoring plaintexts against the character probabilities in
+ * @table with @scorer.  For the chi-squared and log-likelihood scorers, @table is
+ * normalized to sum to one, and byte values it gives no probability to are
+ * treated as very unlikely rather than impossible.
+ */
+void cpal_analysis_model_init_scorer(struct cpal_analysis_model *model,
+				     const double table[256],
+				     const enum cpal_analysis_scorer scorer);
+
+/**
+ * Count the occurrences of every byte value in @data.
+ *
+ * @data The data to count the bytes of.
+ * @len The length of @data.
+ * @histogram [out] The location to store the count of each byte value in.
+ */
+void cpal_analysis_histogram(const uint8_t *data, const size_t len,
+			     size_t histogram[256]);
+
+/**
+ * Count the occurrences of each byte value in @view into @histogram.
+ */
+void cpal_analysis_histogram_strided(const struct cpal_strided_view *view,
+				     size_t histogram[256]);
+
+/**
+ * Count the occurrences of each byte value in every column of the @len bytes of
+ * @data laid out in rows of @columns bytes, in a single pass over @data.  Column
+ * i is counted into @histograms[i], the same counts as
+ * @cpal_analysis_histogram_strided gives for its view.
+ */
+void cpal_analysis_column_histograms(const uint8_t *data, const size_t len,
+				     const size_t columns,
+				     size_t (*histograms)[256]);
+
+/**
+ * Score a plaintext with the scorer of @model.  With the Bhattacharyya scorer
+ * this is the same as @cpal_analysis_bhattacharyya_score, in a single pass over
+ * @decrypted.
+ */
+double cpal_analysis_model_score(const struct cpal_analysis_model *model,
+				 const uint8_t *decrypted, const size_t len);
+
+/**
+ * Score the bytes of @view in the same way as @cpal_analysis_model_score.
+ */
+double cpal_analysis_model_score_strided(const struct cpal_analysis_model *model,
+					 const struct cpal_strided_view *view);
+
+/**
+ * Score a plaintext of @len bytes from its byte @histogram, as produced by
+ * @cpal_analysis_histogram.
+ */
+double cpal_analysis_model_score_histogram(const struct cpal_analysis_model *model,
+					   const size_t histogram[256],
+					   const size_t len);
+
+/**
+ * Return a model of English text scoring with @scorer, prepared from
+ * @cpal_analysis_init_english_probabilities when the library is loaded, or NULL
+ * if @scorer is unknown.  The model is shared and must not be modified.
+ */
+const struct cpal_analysis_model *
+cpal_analysis_english_model(const enum cpal_analysis_scorer scorer);
+
+/**
+ * A candidate kept by a top-K collector: its @score, the @key it was decrypted
+ * with and the index @idx of the ciphertext it came from.  No plaintext is kept,
+ * the winners are decrypted again once the search is over.
+ */
+struct cpal_analysis_top_entry {
+	double score;
+	uint64_t key;
+	size_t idx;
+};
+
+/**
+ * A collector of the best scoring candidates seen, kept as a heap in a fixed
+ * array of entries supplied by the caller, so collecting allocates nothing no
+ * matter how many candidates are offered.  The members other than @len, the
+ * number of candidates kept, are private to the library; initialize the
+ * collector with @cpal_analysis_top_init.
+ */
+struct cpal_analysis_top {
+	struct cpal_analysis_top_entry *entries;
+	size_t capacity;
+	size_t len;
+};
+
+/**
+ * Initialize @top to collect the best @capacity candidates in @entries.
+ */
+void cpal_analysis_top_init(struct cpal_analysis_top *top,
+			    struct cpal_analysis_top_entry *entries,
+			    const size_t capacity);
+
+/**
+ * Offer a candidate to @top, which is kept if it scores better than the worst
+ * candidate kept so far or there is still room for it.  Equal scores are ranked
+ * by the lowest @idx, then the lowest @key.
+ *
+ * @return 1 if the candidate was kept, or 0 otherwise.
+ */
+int cpal_analysis_top_offer(struct cpal_analysis_top *top, const double score,
+			    const uint64_t key, const size_t idx);
+
+/**
+ * Return the score a candidate has to beat to be kept by @top, which is
+ * -INFINITY until @top is full.
+ */
+double cpal_analysis_top_threshold(const struct cpal_analysis_top *top);
+
+/**
+ * Sort the candidates kept by @top best first, into the first @top->len entries
+ * of the array given to @cpal_analysis_top_init.  No more candidates may be
+ * offered once sorted.
+ */
+void cpal_analysis_top_sort(struct cpal_analysis_top *top);
+
+/**
+ * Score all 256 single-byte XOR keys of @ciphertext against @model, and offer
+ * every one to @top as a candidate with index @idx.  Keys are scored from the
+ * byte histogram of @ciphertext alone, without decrypting it.
+ */
+void cpal_analysis_rank_single_byte_xor(const struct cpal_analysis_model *model,
+					const uint8_t *ciphertext, const size_t len,
+					const size_t idx, struct cpal_analysis_top *top);
+
+/**
+ * Like @cpal_analysis_rank_single_byte_xor, for the ciphertext bytes in @view.
+ */
+void cpal_analysis_rank_single_byte_xor_strided(
+    const struct cpal_analysis_model *model, const struct cpal_strided_view *view,
+    const size_t idx, struct cpal_analysis_top *top);
+
+/**
+ * Score the plaintext that decrypting @ciphertext with the repeating XOR @key
+ * would give against @model, without storing the plaintext.  Unlike
+ * @cpal_analysis_try_key, decrypting and scoring are fused into one pass with no
+ * callbacks.
+ *
+ * @return The score, or -INFINITY if @key_len is 0.
+ */
+double cpal_analysis_score_xor(const struct cpal_analysis_model *model,
+			       const uint8_t *ciphertext, const size_t len,
+			       const uint8_t *key, const size_t key_len);
+
+/**
+ * Score @ciphertext decrypted with each of @key_count repeating XOR keys of
+ * @key_len bytes, packed back-to-back in @keys, in the same way as
+ * @cpal_analysis_score_xor.  Every key is offered to @top as a candidate with
+ * index @idx, identified by its position in @keys.
+ *
+ * @return 0 if successful, or -EINVAL if @key_len is 0.
+ */
+int cpal_analysis_search_xor(const struct cpal_analysis_model *model,
+			     const uint8_t *ciphertext, const size_t len,
+			     const uint8_t *keys, const size_t key_len,
+			     const size_t key_count, const size_t idx,
+			     struct cpal_analysis_top *top);
+
+/**
+ * Like @cpal_analysis_search_xor, but keys are dropped part of the way through
+ * decrypting and scoring them, without being offered to @top, as soon as it is
+ * clear they won't be kept.  Keys are checked after 32 bytes, and again each time
+ * the number of bytes scored doubles.  A key is dropped if:
+ *
+ * - The ratio of the 32 bytes before a check which are printable ASCII, tabs or
+ *   line breaks is below @min_printable, from 0 to 1.  Pass 0 to never drop keys
+ *   for this.
+ * - The best score the rest of the plaintext could possibly give it is worse than
+ *   @cpal_analysis_top_threshold.  Keys that could still be kept are never
+ *   dropped for this, so without @min_printable the same keys are kept as with
+ *   @cpal_analysis_search_xor.
+ *
+ * The score bound is only effective with @CPAL_ANALYSIS_LOG_LIKELIHOOD.  The
+ * Bhattacharyya and chi-squared scores depend mostly on the bytes not yet
+ * scored, so their bounds drop keys only once @top is full of plaintexts close to
+ * English, and Bhattacharyya's few even then.  Use @min_printable to drop keys
+ * early with those scorers.
+ *
+ * @return The number of keys dropped, or -EINVAL if @key_len is 0 or
+ * @min_printable is not between 0 and 1.
+ */
+int cpal_analysis_search_xor_pruned(const struct cpal_analysis_model *model,
+				    const uint8_t *ciphertext, const size_t len,
+				    const uint8_t *keys, const size_t key_len,
+				    const size_t key_count, const size_t idx,
+				    struct cpal_analysis_top *top,
+				    const double min_printable);
+
+/**
+ * Find the single-byte XOR keys which decrypt @ciphertext to the plaintexts
+ * scoring best against @model.  All 256 keys are ranked with
+ * @cpal_analysis_rank_single_byte_xor, and only the best @count are decrypted.
+ *
+ * @model The model to score plaintexts against.
+ * @ciphertext The ciphertext to find the key of.
+ * @len The length of the ciphertext, in bytes.
+ * @scores [out] The location to store the best @count keys in, best first.  The
+ * decrypted text and key stored in each must be free()'d.
+ * @count The number of keys to store in @scores.
+ *
+ * @return The number of keys stored in @scores, at most 256, or < 0 on failure.
+ */
+int cpal_analysis_best_single_byte_xor(const struct cpal_analysis_model *model,
+				       const uint8_t *ciphertext, const size_t len,
+				       struct cpal_analysis_key_score *scores,
+				       const size_t count);
+
+/**
+ * Break repeating-key XOR.  Key sizes from @min_key_len up to @max_key_len are
+ * ranked by the normalized Hamming distance between consecutive blocks of
+ * @ciphertext, then each column of the most likely sizes is solved on its own
+ * as single-byte XOR, spread over the threads of @pool (or on the calling thread
+ * if @pool is NULL).  Key sizes need at least two blocks of ciphertext to be
+ * considered.
+ *
+ * @model The model to score plaintexts against.
+ * @scores [out] The location to store the best @count full keys in, best first
+ * by the score of their whole plaintext.  The decrypted text and key stored in
+ * each must be free()'d.
+ * @count The number of keys to store in @scores, at most 64.
+ *
+ * @return The number of keys stored in @scores, or < 0 on failure.
+ */
+int cpal_analysis_break_repeating_xor(const struct cpal_analysis_model *model,
+				      const uint8_t *ciphertext, const size_t len,
+				      const size_t min_key_len,
+				      const size_t max_key_len,
+				      struct cpal_analysis_key_score *scores,
+				      const size_t count, struct cpal_pool *pool);
+
+/**
+ * An n-gram language model, memory-mapped from a file written by
+ * @cpal_ngram_model_build.  Each byte is scored by the log-probability of its
+ * class following the classes of the order - 1 bytes before it, which takes a
+ * single table lookup.  The members are private to the library; open a model
+ * with @cpal_ngram_model_open.
+ */
+struct cpal_ngram_model {
+	const uint8_t *class_map;
+	const int16_t *log_probabilities;
+	uint32_t order;
+	uint32_t class_bits;
+	size_t mask;
+	size_t start;
+	double scale;
+	void *mapping;
+	size_t mapping_len;
+};
+
+/**
+ * Fill @class_map with a class for every byte suited to English text: one for
+ * each letter regardless of case, and one each for spaces, digits, line breaks
+ * and tabs, sentence punctuation, other printable characters and everything
+ * else.
+ *
+ * @return The number of bits the classes need, to pass to
+ * @cpal_ngram_model_build.
+ */
+unsigned int cpal_ngram_english_classes(uint8_t class_map[256]);
+
+/**
+ * Count the n-grams of classes in @corpus and write a model of them to the file
+ * at @path, replacing it if it exists.  Probabilities are add-one smoothed, with
+ * contexts @corpus never had backing off to the probability of each class on its
+ * own, and the start of a text is treated as though it followed spaces.
+ *
+ * @corpus The text to build the model from.
+ * @len The length of @corpus, in bytes.
+ * @class_map The class of every byte value, each less than 2^@class_bits.
+ * @class_bits The number of bits a class takes, from 1 to 8.
+ * @order The number of bytes in an n-gram, 2 for bigrams and 3 for trigrams.  The
+ * table holds 2^(@class_bits * @order) entries, which may be at most 2^24.
+ * @path The file to write the model to.
+ *
+ * @return 0 if successful, -EINVAL if the model's shape is invalid, or another
+ * negative errno value on failure.
+ */
+int cpal_ngram_model_build(const uint8_t *corpus, const size_t len,
+			   const uint8_t class_map[256],
+			   const unsigned int class_bits, const unsigned int order,
+			   const char *path);
+
+/**
+ * Map the model file at @path into memory as @model.  Nothing is parsed or
+ * copied, the table is used straight from the mapping.
+ *
+ * @return 0 if successful, -EINVAL if @path is not a valid model file, or another
+ * negative errno value on failure.
+ */
+int cpal_ngram_model_open(struct cpal_ngram_model *model, const char *path);
+
+/**
+ * Unmap a @model opened with @cpal_ngram_model_open.
+ */
+void cpal_ngram_model_close(struct cpal_ngram_model *model);
+
+/**
+ * Score @data by the mean natural log of the probability of each of its bytes
+ * under @model.  Higher scores are better.
+ */
+double cpal_ngram_model_score(const struct cpal_ngram_model *model,
+			      const uint8_t *data, const size_t len);
+
+/**
+ * Score the plaintext that decrypting @ciphertext with the repeating XOR @key
+ * would give in the same way as @cpal_ngram_model_score, without storing it.
+ *
+ * @return The score, or -INFINITY if @key_len is 0.
+ */
+double cpal_ngram_model_score_xor(const struct cpal_ngram_model *model,
+				  const uint8_t *ciphertext, const size_t len,
+				  const uint8_t *key, const size_t key_len);
+
+/**
+ * Replace the scores of the @count candidates in @scores with their
+ * @cpal_ngram_model_score, and sort them best first.  This is meant for telling
+ * apart the close winners of a search with a unigram model.
+ */
+void cpal_ngram_model_rescore(const struct cpal_ngram_model *model,
+			      struct cpal_analysis_key_score *scores,
+			      const size_t count);
+
+/**
+ * The best single-byte XOR key of every line of a corpus, as parallel arrays so
+ * that scans over one column only touch that column.  Entry i of each array
+ * describes the same line.  The members are filled in by the library; initialize
+ * the results with @cpal_analysis_batch_init.
+ */
+struct cpal_analysis_batch {
+	double *scores;
+	uint8_t *keys;
+	size_t *lines;
+	size_t capacity;
+	size_t len;
+};
+
+/**
+ * Initialize empty @batch results stored in the caller supplied @scores, @keys
+ * and @lines arrays, each of which must have room for @capacity entries.
+ */
+void cpal_analysis_batch_init(struct cpal_analysis_batch *batch, double *scores,
+			      uint8_t *keys, size_t *lines, const size_t capacity);
+
+/**
+ * Find the best single-byte XOR key of each of the @count lines packed
+ * back-to-back in @corpus, scored against @model.  Line i is the bytes from
+ * @offsets[i] up to @offsets[i + 1], so @offsets holds @count + 1 entries.  The
+ * results are stored in @batch in line order, replacing any it held before.
+ * Lines are spread over the threads of @pool, or scored on the calling thread
+ * if @pool is NULL.
+ *
+ * @return 0 if successful, or -EINVAL if @batch has room for fewer than @count
+ * lines.
+ */
+int cpal_analysis_batch_single_byte_xor(const struct cpal_analysis_model *model,
+					const uint8_t *corpus, const size_t *offsets,
+					const size_t count,
+					struct cpal_analysis_batch *batch,
+					struct cpal_pool *pool);
+
+/**
+ * Like @cpal_analysis_batch_single_byte_xor, but for @count separate lines, where
+ * line i is @lens[i] bytes long and starts at @lines[i].
+ */
+int cpal_analysis_batch_single_byte_xor_vec(const struct cpal_analysis_model *model,
+					    const uint8_t *const *lines,
+					    const size_t *lens, const size_t count,
+					    struct cpal_analysis_batch *batch,
+					    struct cpal_pool *pool);
+
+/**
+ * Reorder the results in @batch best first, moving all three arrays together.
+ * Lines with equal scores are kept in line order.
+ */
+void cpal_analysis_batch_sort(struct cpal_analysis_batch *batch);
+
 /**
  * Initialize a probability distribution table for the English language.
  *
@@ -80,40 +662,417 @@ double cpal_analysis_bhattacharyya_score(const double table[256],
  */
 void cpal_analysis_init_english_probabilities(double table[256]);
 
-int cpal_base16_decode(const char *input, size_t input_size, uint8_t **output,
+/*
+ * RFC 4648 encoding and decoding.
+ *
+ * The allocating functions store a newly allocated result in @output which must
+ * be free()'d.  Encoded results are NULL-terminated and the terminator is
+ * included in @output_size.
+ *
+ * The _into variants write into a caller supplied @output buffer instead.
+ * @output_size holds the capacity of @output on entry and the number of bytes
+ * written on return.  Encoded results are not NULL-terminated.  If @output is
+ * too small, -ENOSPC is returned and nothing is written.
+ *
+ * The _encoded_len and _decoded_len functions return the exact number of
+ * characters or bytes an _into call will write, so one buffer can be sized once
+ * and reused.  Decoded lengths depend on the padding of the final group, so
+ * they need the encoded data as well as its length.
+ */
+int cpal_base16_decode(const char *input, const size_t input_size, uint8_t **output,
 		       size_t *output_size);
+int cpal_base16_decode_into(const char *input, const size_t input_size,
+			    uint8_t *output, size_t *output_size);
+size_t cpal_base16_decoded_len(const char *input, const size_t input_size);
 int cpal_base16_encode(const uint8_t *input, const size_t input_size, char **output,
 		       size_t *output_size);
+int cpal_base16_encode_into(const uint8_t *input, const size_t input_size,
+			    char *output, size_t *output_size);
+size_t cpal_base16_encoded_len(const size_t input_size);
+
+/**
+ * Encode @input as base16 using lowercase hex digits, rather than the uppercase
+ * digits of the RFC 4648 alphabet.  The output decodes with @cpal_base16_decode.
+ */
+int cpal_base16_encode_lowercase(const uint8_t *input, const size_t input_size,
+				 char **output, size_t *output_size);
+int cpal_base16_encode_lowercase_into(const uint8_t *input, const size_t input_size,
+				      char *output, size_t *output_size);
 
 int cpal_base32_decode(const char *input, const size_t input_size, uint8_t **output,
 		       size_t *output_size);
+int cpal_base32_decode_into(const char *input, const size_t input_size,
+			    uint8_t *output, size_t *output_size);
+size_t cpal_base32_decoded_len(const char *input, const size_t input_size);
 int cpal_base32_encode(const uint8_t *input, const size_t input_size, char **output,
 		       size_t *output_size);
+int cpal_base32_encode_into(const uint8_t *input, const size_t input_size,
+			    char *output, size_t *output_size);
+size_t cpal_base32_encoded_len(const size_t input_size);
 
-int cpal_base32hex_decode(const char *input, const size_t input_size, char **output,
-			  size_t *output_size);
+int cpal_base32hex_decode(const char *input, const size_t input_size,
+			  uint8_t **output, size_t *output_size);
+int cpal_base32hex_decode_into(const char *input, const size_t input_size,
+			       uint8_t *output, size_t *output_size);
+size_t cpal_base32hex_decoded_len(const char *input, const size_t input_size);
 int cpal_base32hex_encode(const uint8_t *input, const size_t input_size,
 			  char **output, size_t *output_size);
+int cpal_base32hex_encode_into(const uint8_t *input, const size_t input_size,
+			       char *output, size_t *output_size);
+size_t cpal_base32hex_encoded_len(const size_t input_size);
 
 int cpal_base64_decode(const char *input, const size_t input_size, uint8_t **output,
 		       size_t *output_size);
+int cpal_base64_decode_into(const char *input, const size_t input_size,
+			    uint8_t *output, size_t *output_size);
+size_t cpal_base64_decoded_len(const char *input, const size_t input_size);
 int cpal_base64_encode(const uint8_t *input, const size_t input_size, char **output,
 		       size_t *output_size);
+int cpal_base64_encode_into(const uint8_t *input, const size_t input_size,
+			    char *output, size_t *output_size);
+size_t cpal_base64_encoded_len(const size_t input_size);
+
+/**
+ * Decode base64 which may be wrapped over several lines or otherwise contain
+ * whitespace, which is skipped as the input is decoded.  The padding of the
+ * final group may be omitted.
+ *
+ * @cpal_base64_decoded_wrapped_len returns a capacity for @output which is
+ * always large enough, as the amount of whitespace isn't known up front.  If
+ * decoding fails part of the output may already have been written.
+ */
+int cpal_base64_decode_wrapped(const char *input, const size_t input_size,
+			       uint8_t **output, size_t *output_size);
+int cpal_base64_decode_wrapped_into(const char *input, const size_t input_size,
+				    uint8_t *output, size_t *output_size);
+size_t cpal_base64_decoded_wrapped_len(const size_t input_size);
+
+/**
+ * Encode @input as base64 with a line break ('\n') after every @line_len
+ * characters, which must be a multiple of 4 (e.g. 64 for PEM, 76 for MIME).
+ * No line break follows the final line.  A @line_len of 0 disables wrapping, in
+ * the encoders and in @cpal_base64_encoded_wrapped_len alike.
+ *
+ * @return 0 if successful, -EINVAL if @line_len isn't valid, or -ENOSPC if
+ * @output is too small.
+ */
+int cpal_base64_encode_wrapped(const uint8_t *input, const size_t input_size,
+			       const size_t line_len, char **output,
+			       size_t *output_size);
+int cpal_base64_encode_wrapped_into(const uint8_t *input, const size_t input_size,
+				    const size_t line_len, char *output,
+				    size_t *output_size);
+size_t cpal_base64_encoded_wrapped_len(const size_t input_size,
+				       const size_t line_len);
 
 int cpal_base64safe_decode(const char *input, const size_t input_size,
 			   uint8_t **output, size_t *output_size);
+int cpal_base64safe_decode_into(const char *input, const size_t input_size,
+				uint8_t *output, size_t *output_size);
+size_t cpal_base64safe_decoded_len(const char *input, const size_t input_size);
 int cpal_base64safe_encode(const uint8_t *input, const size_t input_size,
 			   char **output, size_t *output_size);
+int cpal_base64safe_encode_into(const uint8_t *input, const size_t input_size,
+				char *output, size_t *output_size);
+size_t cpal_base64safe_encoded_len(const size_t input_size);
 
+/**
+ * The largest group of any RFC 4648 encoding scheme (base32), in characters and
+ * in bytes.  The streaming contexts never buffer more than one group.
+ */
+#define CPAL_RFC4648_MAX_GROUP_CHARS 8
+#define CPAL_RFC4648_MAX_GROUP_BYTES 5
+
+/**
+ * Incremental RFC 4648 decoder for inputs which don't fit in memory at once.
+ * Arbitrarily sized chunks are fed to @cpal_rfc4648_decoder_update, and any
+ * partial group is carried over to the next call.  The members are private to
+ * the library; initialize the context with one of the cpal_*_decoder_init
+ * functions.
+ */
+struct cpal_rfc4648_decoder {
+	int (*decode_into)(const char *input, const size_t input_size,
+			   uint8_t *output, size_t *output_size);
+	uint8_t group_chars;
+	uint8_t group_bytes;
+	uint8_t output_group_bits;
+	uint8_t finished;
+	size_t partial_len;
+	char partial[CPAL_RFC4648_MAX_GROUP_CHARS];
+};
+
+/**
+ * Incremental RFC 4648 encoder, the counterpart to struct cpal_rfc4648_decoder.
+ * Initialize the context with one of the cpal_*_encoder_init functions.
+ */
+struct cpal_rfc4648_encoder {
+	int (*encode_into)(const uint8_t *input, const size_t input_size,
+			   char *output, size_t *output_size);
+	uint8_t group_chars;
+	uint8_t group_bytes;
+	size_t partial_len;
+	uint8_t partial[CPAL_RFC4648_MAX_GROUP_BYTES];
+};
+
+void cpal_base16_decoder_init(struct cpal_rfc4648_decoder *decoder);
+void cpal_base32_decoder_init(struct cpal_rfc4648_decoder *decoder);
+void cpal_base32hex_decoder_init(struct cpal_rfc4648_decoder *decoder);
+void cpal_base64_decoder_init(struct cpal_rfc4648_decoder *decoder);
+void cpal_base64safe_decoder_init(struct cpal_rfc4648_decoder *decoder);
+
+void cpal_base16_encoder_init(struct cpal_rfc4648_encoder *encoder);
+void cpal_base32_encoder_init(struct cpal_rfc4648_encoder *encoder);
+void cpal_base32hex_encoder_init(struct cpal_rfc4648_encoder *encoder);
+void cpal_base64_encoder_init(struct cpal_rfc4648_encoder *encoder);
+void cpal_base64safe_encoder_init(struct cpal_rfc4648_encoder *encoder);
+
+/**
+ * Calculate the largest number of bytes @cpal_rfc4648_decoder_update can write
+ * when given @input_size more characters.
+ */
+size_t cpal_rfc4648_decoder_max_output(const struct cpal_rfc4648_decoder *decoder,
+				       const size_t input_size);
+
+/**
+ * Decode the next chunk of an encoded stream.  Every complete group is decoded
+ * and written to @output, and any trailing partial group is kept in @decoder
+ * until the next call.
+ *
+ * @decoder The decoding context.
+ * @input The next chunk of encoded characters.
+ * @input_size The number of characters in @input.
+ * @output [out] The location to store the decoded data in.
+ * @output_size [in,out] The capacity of @output on entry, and the number of bytes
+ * written on return.
+ *
+ * @return 0 if successful, -ENOSPC if @output is too small, or -EINVAL if the
+ * input is not valid or continues after a padded group.
+ */
+int cpal_rfc4648_decoder_update(struct cpal_rfc4648_decoder *decoder,
+				const char *input, const size_t input_size,
+				uint8_t *output, size_t *output_size);
+
+/**
+ * Finish decoding a stream.  A final group with its padding omitted is accepted
+ * and decoded as if it were padded.  At most CPAL_RFC4648_MAX_GROUP_BYTES bytes
+ * are written.
+ *
+ * @return 0 if successful, -ENOSPC if @output is too small, or -EINVAL if the
+ * stream ended part way through a group that can't be completed with padding.
+ */
+int cpal_rfc4648_decoder_finalize(struct cpal_rfc4648_decoder *decoder,
+				  uint8_t *output, size_t *output_size);
+
+/**
+ * Calculate the largest number of characters @cpal_rfc4648_encoder_update can
+ * write when given @input_size more bytes.
+ */
+size_t cpal_rfc4648_encoder_max_output(const struct cpal_rfc4648_encoder *encoder,
+				       const size_t input_size);
+
+/**
+ * Encode the next chunk of a stream.  Every complete group is encoded and
+ * written to @output, and any trailing partial group is kept in @encoder until
+ * the next call.  No padding or NULL terminator is written.
+ *
+ * @return 0 if successful, or -ENOSPC if @output is too small.
+ */
+int cpal_rfc4648_encoder_update(struct cpal_rfc4648_encoder *encoder,
+				const uint8_t *input, const size_t input_size,
+				char *output, size_t *output_size);
+
+/**
+ * Finish encoding a stream, writing the final partial group and its padding.  At
+ * most CPAL_RFC4648_MAX_GROUP_CHARS characters are written.
+ *
+ * @return 0 if successful, or -ENOSPC if @output is too small.
+ */
+int cpal_rfc4648_encoder_finalize(struct cpal_rfc4648_encoder *encoder,
+				  char *output, size_t *output_size);
+
+/*
+ * Multi-threaded RFC 4648 encoding and decoding.
+ *
+ * These behave like the _into variants, but split the input at group boundaries
+ * and encode or decode the slices on the threads of @pool at once, each writing
+ * directly to its own part of @output.  The _parallel variants run on a pool of
+ * up to @threads threads created for the call instead, where 0 uses one thread
+ * per online CPU.  Inputs too small to benefit are handled on the calling thread
+ * alone.
+ */
+int cpal_base16_decode_pool(const char *input, const size_t input_size,
+			    uint8_t *output, size_t *output_size,
+			    struct cpal_pool *pool);
+int cpal_base16_decode_parallel(const char *input, const size_t input_size,
+				uint8_t *output, size_t *output_size,
+				unsigned int threads);
+int cpal_base16_encode_pool(const uint8_t *input, const size_t input_size,
+			    char *output, size_t *output_size,
+			    struct cpal_pool *pool);
+int cpal_base16_encode_parallel(const uint8_t *input, const size_t input_size,
+				char *output, size_t *output_size,
+				unsigned int threads);
+int cpal_base32_decode_pool(const char *input, const size_t input_size,
+			    uint8_t *output, size_t *output_size,
+			    struct cpal_pool *pool);
+int cpal_base32_decode_parallel(const char *input, const size_t input_size,
+				uint8_t *output, size_t *output_size,
+				unsigned int threads);
+int cpal_base32_encode_pool(const uint8_t *input, const size_t input_size,
+			    char *output, size_t *output_size,
+			    struct cpal_pool *pool);
+int cpal_base32_encode_parallel(const uint8_t *input, const size_t input_size,
+				char *output, size_t *output_size,
+				unsigned int threads);
+int cpal_base32hex_decode_pool(const char *input, const size_t input_size,
+			       uint8_t *output, size_t *output_size,
+			       struct cpal_pool *pool);
+int cpal_base32hex_decode_parallel(const char *input, const size_t input_size,
+				   uint8_t *output, size_t *output_size,
+				   unsigned int threads);
+int cpal_base32hex_encode_pool(const uint8_t *input, const size_t input_size,
+			       char *output, size_t *output_size,
+			       struct cpal_pool *pool);
+int cpal_base32hex_encode_parallel(const uint8_t *input, const size_t input_size,
+				   char *output, size_t *output_size,
+				   unsigned int threads);
+int cpal_base64_decode_pool(const char *input, const size_t input_size,
+			    uint8_t *output, size_t *output_size,
+			    struct cpal_pool *pool);
+int cpal_base64_decode_parallel(const char *input, const size_t input_size,
+				uint8_t *output, size_t *output_size,
+				unsigned int threads);
+int cpal_base64_encode_pool(const uint8_t *input, const size_t input_size,
+			    char *output, size_t *output_size,
+			    struct cpal_pool *pool);
+int cpal_base64_encode_parallel(const uint8_t *input, const size_t input_size,
+				char *output, size_t *output_size,
+				unsigned int threads);
+int cpal_base64safe_decode_pool(const char *input, const size_t input_size,
+				uint8_t *output, size_t *output_size,
+				struct cpal_pool *pool);
+int cpal_base64safe_decode_parallel(const char *input, const size_t input_size,
+				    uint8_t *output, size_t *output_size,
+				    unsigned int threads);
+int cpal_base64safe_encode_pool(const uint8_t *input, const size_t input_size,
+				char *output, size_t *output_size,
+				struct cpal_pool *pool);
+int cpal_base64safe_encode_parallel(const uint8_t *input, const size_t input_size,
+				    char *output, size_t *output_size,
+				    unsigned int threads);
+
+/*
+ * XOR ciphers.
+ *
+ * The allocating functions store a newly allocated result of @len bytes in
+ * @output which must be free()'d.  The _into variants write @len bytes to a
+ * caller supplied @output buffer instead, which may be the input buffer itself
+ * but must not otherwise overlap it.  The _inplace variants overwrite their
+ * first buffer with the result.
+ */
 int cpal_cipher_xor_fixed(const size_t len, const uint8_t *a, const uint8_t *b,
 			  uint8_t **output);
+int cpal_cipher_xor_fixed_into(const size_t len, const uint8_t *a,
+			       const uint8_t *b, uint8_t *output);
+int cpal_cipher_xor_fixed_inplace(const size_t len, uint8_t *a, const uint8_t *b);
 
 int cpal_cipher_xor_bytewise(const uint8_t *input, const size_t len,
 			     const uint8_t key, uint8_t **output);
+int cpal_cipher_xor_bytewise_into(const uint8_t *input, const size_t len,
+				  const uint8_t key, uint8_t *output);
+int cpal_cipher_xor_bytewise_inplace(uint8_t *data, const size_t len,
+				     const uint8_t key);
+
+/**
+ * XOR every byte of @input with @key, writing the @input->count results to
+ * @output one after the other.
+ */
+int cpal_cipher_xor_bytewise_strided_into(const struct cpal_strided_view *input,
+					  const uint8_t key, uint8_t *output);
 
 int cpal_cipher_xor_repeating(const uint8_t *input, const size_t len,
 			      const uint8_t *key, const size_t key_len,
 			      uint8_t **output);
+int cpal_cipher_xor_repeating_into(const uint8_t *input, const size_t len,
+				   const uint8_t *key, const size_t key_len,
+				   uint8_t *output);
+int cpal_cipher_xor_repeating_inplace(uint8_t *data, const size_t len,
+				      const uint8_t *key, const size_t key_len);
+
+/**
+ * A stream XOR'd with a keystream, processed chunk by chunk.  The keystream is
+ * either a key repeated for as long as the stream goes on, or a fixed pad which
+ * covers the whole stream and ends it.  The members are private to the library;
+ * initialize the context with @cpal_xor_stream_init_repeating or
+ * @cpal_xor_stream_init_fixed.  The key is not copied, and must outlive the
+ * context.
+ */
+struct cpal_xor_stream {
+	const uint8_t *key;
+	size_t key_len;
+	size_t phase;
+	uint64_t offset;
+	uint8_t repeating;
+};
+
+/**
+ * Initialize @stream with a repeating @key, starting at offset 0.
+ *
+ * @return 0 if successful, or -EINVAL if @key_len is 0.
+ */
+int cpal_xor_stream_init_repeating(struct cpal_xor_stream *stream,
+				   const uint8_t *key, const size_t key_len);
+
+/**
+ * Initialize @stream with a fixed @pad of @pad_len bytes, which is also the
+ * length of the stream.
+ */
+void cpal_xor_stream_init_fixed(struct cpal_xor_stream *stream, const uint8_t *pad,
+				const size_t pad_len);
+
+/**
+ * Move @stream to byte @offset of the stream, in constant time.
+ *
+ * @return 0 if successful, or -EINVAL if @offset is past the end of a fixed pad.
+ */
+int cpal_xor_stream_seek(struct cpal_xor_stream *stream, const uint64_t offset);
+
+/**
+ * Return the offset in the stream the next chunk will be processed at.
+ */
+uint64_t cpal_xor_stream_tell(const struct cpal_xor_stream *stream);
+
+/**
+ * XOR the next @len bytes of the stream from @input into @output, which may be
+ * the same buffer, and advance the stream past them.
+ *
+ * @return 0 if successful, or -EINVAL if the chunk runs past the end of a fixed
+ * pad, in which case nothing is written.
+ */
+int cpal_xor_stream_process_into(struct cpal_xor_stream *stream,
+				 const uint8_t *input, const size_t len,
+				 uint8_t *output);
+int cpal_xor_stream_process(struct cpal_xor_stream *stream, uint8_t *data,
+			    const size_t len);
+
+/**
+ * Count the bits which differ between the @len bytes of @a and @b.
+ */
+uint64_t cpal_hamming_distance(const uint8_t *a, const uint8_t *b, const size_t len);
+
+/**
+ * Compute the Hamming distance between every pair of the @count blocks of
+ * @block_len bytes stored back-to-back in @blocks, spread over the threads of
+ * @pool (or on the calling thread if @pool is NULL).
+ *
+ * @matrix [out] The location to store the @count by @count distances in, with
+ * the distance between blocks i and j at @matrix[i * @count + j].
+ *
+ * @return 0 if successful, or -EINVAL if @blocks or @matrix is NULL.
+ */
+int cpal_hamming_distance_matrix(const uint8_t *blocks, const size_t block_len,
+				 const size_t count, uint64_t *matrix,
+				 struct cpal_pool *pool);
 
 /**
  * Print a buffer to STDOUT and replace any non-printable characters with
@@ -1,57 +1,171 @@
 #include <cryptopal-common.h>
 
+#include "cipher_xor_kernels_internal.h"
+
 #include <errno.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+/**
+ * The size of the keystream a short repeating key is expanded to, so that every
+ * call to the XOR kernel covers enough bytes to run at full speed whatever the
+ * length of the key.
+ */
+#define CIPHER_XOR_PATTERN_SIZE 4096
+
+/**
+ * The widest vector any XOR kernel works with.  Keystream periods that are a
+ * multiple of this keep every vector of every block at the same alignment.
+ */
+#define CIPHER_XOR_VECTOR_SIZE 64
+
 int cpal_cipher_xor_fixed(const size_t len, const uint8_t *a, const uint8_t *b,
 			  uint8_t **output)
 {
-	uint8_t *output_tmp = calloc(sizeof *output_tmp, len);
+	uint8_t *output_tmp = malloc(len);
 
 	if (output_tmp == NULL) {
 		return -ENOMEM;
 	}
 
-	for (size_t i = 0; i < len; i++) {
-		output_tmp[i] = a[i] ^ b[i];
-	}
+	cpal_cipher_xor_fixed_into(len, a, b, output_tmp);
 
 	*output = output_tmp;
 	return 0;
 }
 
+int cpal_cipher_xor_fixed_into(const size_t len, const uint8_t *a,
+			       const uint8_t *b, uint8_t *output)
+{
+	cipher_xor_fixed_kernel(a, b, output, len);
+	return 0;
+}
+
+int cpal_cipher_xor_fixed_inplace(const size_t len, uint8_t *a, const uint8_t *b)
+{
+	return cpal_cipher_xor_fixed_into(len, a, b, a);
+}
+
 int cpal_cipher_xor_bytewise(const uint8_t *input, const size_t len,
 			     const uint8_t key, uint8_t **output)
 {
-	uint8_t *output_tmp = calloc(sizeof *output_tmp, len);
+	uint8_t *output_tmp = malloc(len);
 
 	if (output_tmp == NULL) {
 		return -ENOMEM;
 	}
 
-	for (size_t i = 0; i < len; i++) {
-		output_tmp[i] = input[i] ^ key;
-	}
+	cpal_cipher_xor_bytewise_into(input, len, key, output_tmp);
 
 	*output = output_tmp;
 	return 0;
 }
 
+int cpal_cipher_xor_bytewise_into(const uint8_t *input, const size_t len,
+				  const uint8_t key, uint8_t *output)
+{
+	cipher_xor_bytewise_kernel(input, key, output, len);
+	return 0;
+}
+
+int cpal_cipher_xor_bytewise_inplace(uint8_t *data, const size_t len,
+				     const uint8_t key)
+{
+	return cpal_cipher_xor_bytewise_into(data, len, key, data);
+}
+
+int cpal_cipher_xor_bytewise_strided_into(const struct cpal_strided_view *input,
+					  const uint8_t key, uint8_t *output)
+{
+	if (input->stride == 1) {
+		cipher_xor_bytewise_kernel(input->base, key, output, input->count);
+		return 0;
+	}
+
+	for (size_t pos = 0; pos < input->count; pos++) {
+		output[pos] = input->base[pos * input->stride] ^ key;
+	}
+
+	return 0;
+}
+
 int cpal_cipher_xor_repeating(const uint8_t *input, size_t len, const uint8_t *key,
 			      size_t key_len, uint8_t **output)
 {
-	uint8_t *output_tmp = calloc(sizeof *output_tmp, len);
+	uint8_t *output_tmp = malloc(len);
 
 	if (output_tmp == NULL) {
 		return -ENOMEM;
 	}
 
-	for (size_t i = 0; i < len; i++) {
-		output_tmp[i] = input[i] ^ key[i % key_len];
+	int err = cpal_cipher_xor_repeating_into(input, len, key, key_len, output_tmp);
+
+	if (err < 0) {
+		free(output_tmp);
+		return err;
 	}
 
 	*output = output_tmp;
 	return 0;
 }
+
+int cpal_cipher_xor_repeating_into(const uint8_t *input, const size_t len,
+				   const uint8_t *key, const size_t key_len,
+				   uint8_t *output)
+{
+	uint8_t pattern[CIPHER_XOR_PATTERN_SIZE];
+	const uint8_t *period = key;
+	size_t period_len = key_len;
+
+	if (key_len == 0) {
+		return -EINVAL;
+	}
+
+	// XOR'ing a whole number of key repetitions at a time always starts the
+	// next block back at the start of the key, so no position in the key ever
+	// needs to be tracked.  Short keys are first repeated into a longer period,
+	// a multiple of the vector size too whenever it fits.
+	if (key_len <= CIPHER_XOR_PATTERN_SIZE / 2 && len > key_len) {
+		size_t common = key_len & -key_len;
+		size_t unit = key_len;
+		size_t filled = key_len;
+
+		if (common < CIPHER_XOR_VECTOR_SIZE &&
+		    key_len * (CIPHER_XOR_VECTOR_SIZE / common) <=
+			CIPHER_XOR_PATTERN_SIZE) {
+			unit = key_len * (CIPHER_XOR_VECTOR_SIZE / common);
+		}
+
+		period_len = (len + key_len - 1) / key_len * key_len;
+		if (period_len > CIPHER_XOR_PATTERN_SIZE / unit * unit) {
+			period_len = CIPHER_XOR_PATTERN_SIZE / unit * unit;
+		}
+
+		memcpy(pattern, key, key_len);
+
+		while (filled < period_len) {
+			size_t copied = filled < period_len - filled ? filled
+								     : period_len - filled;
+
+			memcpy(pattern + filled, pattern, copied);
+			filled += copied;
+		}
+
+		period = pattern;
+	}
+
+	for (size_t i = 0; i < len; i += period_len) {
+		size_t block = len - i < period_len ? len - i : period_len;
+
+		cipher_xor_fixed_kernel(input + i, period, output + i, block);
+	}
+
+	return 0;
+}
+
+int cpal_cipher_xor_repeating_inplace(uint8_t *data, const size_t len,
+				      const uint8_t *key, const size_t key_len)
+{
+	return cpal_cipher_xor_repeating_into(data, len, key, key_len, data);
+}
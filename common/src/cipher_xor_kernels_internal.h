@@ -0,0 +1,29 @@
+#ifndef CRYPTOPAL_CIPHER_XOR_KERNELS_INTERNAL_H
+#define CRYPTOPAL_CIPHER_XOR_KERNELS_INTERNAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * XOR @len bytes of @a and @b together into @output.  @output may be the same
+ * buffer as either input, but must not partially overlap them.
+ */
+typedef void (*cipher_xor_fixed_kernel_fn)(const uint8_t *a, const uint8_t *b,
+					   uint8_t *output, size_t len);
+
+/**
+ * XOR every one of @len bytes of @input with @key into @output.  @output may be
+ * the same buffer as @input.
+ */
+typedef void (*cipher_xor_bytewise_kernel_fn)(const uint8_t *input, uint8_t key,
+					      uint8_t *output, size_t len);
+
+/**
+ * The XOR kernels best suited to the running CPU, selected once when the library
+ * is loaded.  Unlike the RFC 4648 kernels these handle the whole buffer,
+ * including any tail shorter than a vector.
+ */
+extern cipher_xor_fixed_kernel_fn cipher_xor_fixed_kernel;
+extern cipher_xor_bytewise_kernel_fn cipher_xor_bytewise_kernel;
+
+#endif
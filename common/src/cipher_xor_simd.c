@@ -0,0 +1,198 @@
+/*
+ * Vectorized XOR kernels for SSE2, AVX2 and AVX-512 capable CPUs.
+ *
+ * XOR has no dependencies between bytes, so the only work is keeping the load
+ * and store ports busy: each loop handles four vectors per iteration and leaves
+ * the final partial vector to a byte loop.
+ */
+
+#include "cipher_xor_kernels_internal.h"
+
+#include <immintrin.h>
+
+#define AVX2 __attribute__((target("avx2")))
+#define AVX512 __attribute__((target("avx512f")))
+
+__attribute__((visibility("hidden"))) cipher_xor_fixed_kernel_fn
+    cipher_xor_fixed_kernel;
+__attribute__((visibility("hidden"))) cipher_xor_bytewise_kernel_fn
+    cipher_xor_bytewise_kernel;
+
+static void xor_fixed_scalar(const uint8_t *a, const uint8_t *b, uint8_t *output,
+			     size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		output[i] = a[i] ^ b[i];
+	}
+}
+
+static void xor_bytewise_scalar(const uint8_t *input, uint8_t key,
+				uint8_t *output, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		output[i] = input[i] ^ key;
+	}
+}
+
+static void xor_fixed_sse2(const uint8_t *a, const uint8_t *b, uint8_t *output,
+			   size_t len)
+{
+	size_t i = 0;
+
+	for (; len - i >= 64; i += 64) {
+		for (size_t j = i; j < i + 64; j += 16) {
+			__m128i x = _mm_loadu_si128((const __m128i *)(a + j));
+			__m128i y = _mm_loadu_si128((const __m128i *)(b + j));
+
+			_mm_storeu_si128((__m128i *)(output + j), _mm_xor_si128(x, y));
+		}
+	}
+
+	for (; len - i >= 16; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+		__m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+
+		_mm_storeu_si128((__m128i *)(output + i), _mm_xor_si128(x, y));
+	}
+
+	xor_fixed_scalar(a + i, b + i, output + i, len - i);
+}
+
+static void xor_bytewise_sse2(const uint8_t *input, uint8_t key, uint8_t *output,
+			      size_t len)
+{
+	const __m128i k = _mm_set1_epi8(key);
+	size_t i = 0;
+
+	for (; len - i >= 64; i += 64) {
+		for (size_t j = i; j < i + 64; j += 16) {
+			__m128i x = _mm_loadu_si128((const __m128i *)(input + j));
+
+			_mm_storeu_si128((__m128i *)(output + j), _mm_xor_si128(x, k));
+		}
+	}
+
+	for (; len - i >= 16; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(input + i));
+
+		_mm_storeu_si128((__m128i *)(output + i), _mm_xor_si128(x, k));
+	}
+
+	xor_bytewise_scalar(input + i, key, output + i, len - i);
+}
+
+AVX2 static void xor_fixed_avx2(const uint8_t *a, const uint8_t *b,
+				uint8_t *output, size_t len)
+{
+	size_t i = 0;
+
+	for (; len - i >= 128; i += 128) {
+		for (size_t j = i; j < i + 128; j += 32) {
+			__m256i x = _mm256_loadu_si256((const __m256i *)(a + j));
+			__m256i y = _mm256_loadu_si256((const __m256i *)(b + j));
+
+			_mm256_storeu_si256((__m256i *)(output + j),
+					    _mm256_xor_si256(x, y));
+		}
+	}
+
+	for (; len - i >= 32; i += 32) {
+		__m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+		__m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+
+		_mm256_storeu_si256((__m256i *)(output + i), _mm256_xor_si256(x, y));
+	}
+
+	xor_fixed_sse2(a + i, b + i, output + i, len - i);
+}
+
+AVX2 static void xor_bytewise_avx2(const uint8_t *input, uint8_t key,
+				   uint8_t *output, size_t len)
+{
+	const __m256i k = _mm256_set1_epi8(key);
+	size_t i = 0;
+
+	for (; len - i >= 128; i += 128) {
+		for (size_t j = i; j < i + 128; j += 32) {
+			__m256i x = _mm256_loadu_si256((const __m256i *)(input + j));
+
+			_mm256_storeu_si256((__m256i *)(output + j),
+					    _mm256_xor_si256(x, k));
+		}
+	}
+
+	for (; len - i >= 32; i += 32) {
+		__m256i x = _mm256_loadu_si256((const __m256i *)(input + i));
+
+		_mm256_storeu_si256((__m256i *)(output + i), _mm256_xor_si256(x, k));
+	}
+
+	xor_bytewise_sse2(input + i, key, output + i, len - i);
+}
+
+AVX512 static void xor_fixed_avx512(const uint8_t *a, const uint8_t *b,
+				    uint8_t *output, size_t len)
+{
+	size_t i = 0;
+
+	for (; len - i >= 256; i += 256) {
+		for (size_t j = i; j < i + 256; j += 64) {
+			__m512i x = _mm512_loadu_si512(a + j);
+			__m512i y = _mm512_loadu_si512(b + j);
+
+			_mm512_storeu_si512(output + j, _mm512_xor_si512(x, y));
+		}
+	}
+
+	for (; len - i >= 64; i += 64) {
+		__m512i x = _mm512_loadu_si512(a + i);
+		__m512i y = _mm512_loadu_si512(b + i);
+
+		_mm512_storeu_si512(output + i, _mm512_xor_si512(x, y));
+	}
+
+	xor_fixed_sse2(a + i, b + i, output + i, len - i);
+}
+
+AVX512 static void xor_bytewise_avx512(const uint8_t *input, uint8_t key,
+				       uint8_t *output, size_t len)
+{
+	const __m512i k = _mm512_set1_epi32(key * 0x01010101u);
+	size_t i = 0;
+
+	for (; len - i >= 256; i += 256) {
+		for (size_t j = i; j < i + 256; j += 64) {
+			__m512i x = _mm512_loadu_si512(input + j);
+
+			_mm512_storeu_si512(output + j, _mm512_xor_si512(x, k));
+		}
+	}
+
+	for (; len - i >= 64; i += 64) {
+		__m512i x = _mm512_loadu_si512(input + i);
+
+		_mm512_storeu_si512(output + i, _mm512_xor_si512(x, k));
+	}
+
+	xor_bytewise_sse2(input + i, key, output + i, len - i);
+}
+
+/**
+ * Select the XOR kernels once, when the library is loaded.  SSE2 is part of the
+ * x86-64 baseline, so it is the fallback rather than the byte loops.
+ */
+__attribute__((constructor)) static void cipher_xor_select_kernels(void)
+{
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx512f")) {
+		cipher_xor_fixed_kernel = xor_fixed_avx512;
+		cipher_xor_bytewise_kernel = xor_bytewise_avx512;
+	} else if (__builtin_cpu_supports("avx2")) {
+		cipher_xor_fixed_kernel = xor_fixed_avx2;
+		cipher_xor_bytewise_kernel = xor_bytewise_avx2;
+	} else {
+		cipher_xor_fixed_kernel = xor_fixed_sse2;
+		cipher_xor_bytewise_kernel = xor_bytewise_sse2;
+	}
+}
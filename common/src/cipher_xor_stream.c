@@ -0,0 +1,94 @@
+/*
+ * XOR keystreams processed chunk by chunk.
+ *
+ * The context only remembers where in the key the next chunk starts.  Each
+ * chunk first finishes the current repetition of the key, and everything after
+ * that starts back at the beginning of the key, so it goes through the same
+ * division-free repeating-key XOR as whole buffers.
+ */
+
+#include <cryptopal-common.h>
+
+#include <errno.h>
+
+int cpal_xor_stream_init_repeating(struct cpal_xor_stream *stream,
+				   const uint8_t *key, const size_t key_len)
+{
+	if (key == NULL || key_len == 0) {
+		return -EINVAL;
+	}
+
+	stream->key = key;
+	stream->key_len = key_len;
+	stream->phase = 0;
+	stream->offset = 0;
+	stream->repeating = 1;
+	return 0;
+}
+
+void cpal_xor_stream_init_fixed(struct cpal_xor_stream *stream, const uint8_t *pad,
+				const size_t pad_len)
+{
+	stream->key = pad;
+	stream->key_len = pad_len;
+	stream->phase = 0;
+	stream->offset = 0;
+	stream->repeating = 0;
+}
+
+int cpal_xor_stream_seek(struct cpal_xor_stream *stream, const uint64_t offset)
+{
+	if (!stream->repeating && offset > stream->key_len) {
+		return -EINVAL;
+	}
+
+	stream->phase = stream->repeating ? offset % stream->key_len : offset;
+	stream->offset = offset;
+	return 0;
+}
+
+uint64_t cpal_xor_stream_tell(const struct cpal_xor_stream *stream)
+{
+	return stream->offset;
+}
+
+int cpal_xor_stream_process_into(struct cpal_xor_stream *stream,
+				 const uint8_t *input, const size_t len,
+				 uint8_t *output)
+{
+	size_t key_left = stream->key_len - stream->phase;
+	size_t head = len < key_left ? len : key_left;
+
+	if (!stream->repeating && len > key_left) {
+		return -EINVAL;
+	}
+
+	// Finish the current repetition of the key
+	cpal_cipher_xor_fixed_into(head, input, stream->key + stream->phase, output);
+
+	stream->phase += head;
+	stream->offset += len;
+
+	if (len == head) {
+		if (stream->repeating && stream->phase == stream->key_len) {
+			stream->phase = 0;
+		}
+
+		return 0;
+	}
+
+	// Anything left over starts back at the beginning of the key
+	size_t rest = len - head;
+
+	cpal_cipher_xor_repeating_into(input + head, rest, stream->key,
+				       stream->key_len, output + head);
+
+	stream->phase = rest % stream->key_len;
+	return 0;
+}
+
+int cpal_xor_stream_process(struct cpal_xor_stream *stream, uint8_t *data,
+			    const size_t len)
+{
+	return cpal_xor_stream_process_into(stream, data, len, data);
+}
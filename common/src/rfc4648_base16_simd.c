@@ -0,0 +1,221 @@
+/*
+ * Vectorized base16 kernels for SSSE3 and AVX2 capable CPUs.
+ *
+ * Every character maps to exactly one nibble, so both directions are a single
+ * shuffle or range check per vector with no group bookkeeping at all.
+ */
+
+#include "rfc4648_kernels_internal.h"
+
+#include <immintrin.h>
+
+#define SSSE3 __attribute__((target("ssse3")))
+#define AVX2 __attribute__((target("avx2")))
+
+__attribute__((visibility("hidden"))) rfc4648_decode_kernel_fn
+    rfc4648_base16_decode_kernel;
+__attribute__((visibility("hidden"))) rfc4648_encode_kernel_fn
+    rfc4648_base16_encode_kernel;
+
+/*
+ * Without SSSE3 there is nothing to gain over the generic decoder, so consume
+ * nothing and leave all of the work to it.
+ */
+static size_t base16_decode_scalar(const char *input, size_t input_size,
+				   uint8_t *output, const char *alphabet)
+{
+	(void)input;
+	(void)input_size;
+	(void)output;
+	(void)alphabet;
+
+	return 0;
+}
+
+static size_t base16_encode_scalar(const uint8_t *input, size_t input_size,
+				   char *output, const char *alphabet)
+{
+	(void)input;
+	(void)input_size;
+	(void)output;
+	(void)alphabet;
+
+	return 0;
+}
+
+/*
+ * Translate 16 characters to their nibble values, returning a mask of the lanes
+ * which held a valid hex digit of either case in @valid.
+ */
+SSSE3 static inline __m128i base16_nibbles_sse(__m128i in, __m128i *valid)
+{
+	__m128i letter = _mm_or_si128(in, _mm_set1_epi8(0x20));
+
+	__m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('0' - 1)),
+					 _mm_cmplt_epi8(in, _mm_set1_epi8('9' + 1)));
+	__m128i is_letter =
+	    _mm_and_si128(_mm_cmpgt_epi8(letter, _mm_set1_epi8('a' - 1)),
+			  _mm_cmplt_epi8(letter, _mm_set1_epi8('f' + 1)));
+
+	*valid = _mm_or_si128(is_digit, is_letter);
+
+	return _mm_or_si128(
+	    _mm_and_si128(is_digit, _mm_sub_epi8(in, _mm_set1_epi8('0'))),
+	    _mm_and_si128(is_letter, _mm_sub_epi8(letter, _mm_set1_epi8('a' - 10))));
+}
+
+SSSE3 static size_t base16_decode_ssse3(const char *input, size_t input_size,
+					uint8_t *output, const char *alphabet)
+{
+	/* Weights for the high and low nibble of each pair of characters */
+	const __m128i nibble_weights = _mm_set1_epi16(0x0110);
+	size_t input_pos = 0;
+
+	(void)alphabet;
+
+	while (input_size - input_pos >= 32) {
+		__m128i valid_lo, valid_hi;
+		const __m128i *in = (const __m128i *)(input + input_pos);
+		__m128i lo = base16_nibbles_sse(_mm_loadu_si128(in), &valid_lo);
+		__m128i hi = base16_nibbles_sse(_mm_loadu_si128(in + 1), &valid_hi);
+
+		if (_mm_movemask_epi8(_mm_and_si128(valid_lo, valid_hi)) != 0xffff) {
+			break;
+		}
+
+		lo = _mm_maddubs_epi16(lo, nibble_weights);
+		hi = _mm_maddubs_epi16(hi, nibble_weights);
+
+		_mm_storeu_si128((__m128i *)output, _mm_packus_epi16(lo, hi));
+
+		input_pos += 32;
+		output += 16;
+	}
+
+	return input_pos;
+}
+
+SSSE3 static size_t base16_encode_ssse3(const uint8_t *input, size_t input_size,
+					char *output, const char *alphabet)
+{
+	const __m128i digits = _mm_loadu_si128((const __m128i *)alphabet);
+	const __m128i nibble_mask = _mm_set1_epi8(0x0f);
+	size_t input_pos = 0;
+
+	while (input_size - input_pos >= 16) {
+		__m128i in = _mm_loadu_si128((const __m128i *)(input + input_pos));
+		__m128i hi = _mm_shuffle_epi8(
+		    digits, _mm_and_si128(_mm_srli_epi16(in, 4), nibble_mask));
+		__m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(in, nibble_mask));
+
+		_mm_storeu_si128((__m128i *)output, _mm_unpacklo_epi8(hi, lo));
+		_mm_storeu_si128((__m128i *)(output + 16), _mm_unpackhi_epi8(hi, lo));
+
+		input_pos += 16;
+		output += 32;
+	}
+
+	return input_pos;
+}
+
+AVX2 static inline __m256i base16_nibbles_avx2(__m256i in, __m256i *valid)
+{
+	__m256i letter = _mm256_or_si256(in, _mm256_set1_epi8(0x20));
+
+	__m256i is_digit =
+	    _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8('0' - 1)),
+			     _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), in));
+	__m256i is_letter =
+	    _mm256_and_si256(_mm256_cmpgt_epi8(letter, _mm256_set1_epi8('a' - 1)),
+			     _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), letter));
+
+	*valid = _mm256_or_si256(is_digit, is_letter);
+
+	return _mm256_or_si256(
+	    _mm256_and_si256(is_digit, _mm256_sub_epi8(in, _mm256_set1_epi8('0'))),
+	    _mm256_and_si256(is_letter,
+			     _mm256_sub_epi8(letter, _mm256_set1_epi8('a' - 10))));
+}
+
+AVX2 static size_t base16_decode_avx2(const char *input, size_t input_size,
+				      uint8_t *output, const char *alphabet)
+{
+	const __m256i nibble_weights = _mm256_set1_epi16(0x0110);
+	size_t input_pos = 0;
+
+	while (input_size - input_pos >= 64) {
+		__m256i valid_lo, valid_hi;
+		const __m256i *in = (const __m256i *)(input + input_pos);
+		__m256i lo = base16_nibbles_avx2(_mm256_loadu_si256(in), &valid_lo);
+		__m256i hi = base16_nibbles_avx2(_mm256_loadu_si256(in + 1), &valid_hi);
+
+		if (_mm256_movemask_epi8(_mm256_and_si256(valid_lo, valid_hi)) != -1) {
+			break;
+		}
+
+		lo = _mm256_maddubs_epi16(lo, nibble_weights);
+		hi = _mm256_maddubs_epi16(hi, nibble_weights);
+
+		/* packus interleaves the 128-bit lanes, so put them back in order */
+		_mm256_storeu_si256(
+		    (__m256i *)output,
+		    _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xd8));
+
+		input_pos += 64;
+		output += 32;
+	}
+
+	return input_pos + base16_decode_ssse3(input + input_pos,
+					       input_size - input_pos, output,
+					       alphabet);
+}
+
+AVX2 static size_t base16_encode_avx2(const uint8_t *input, size_t input_size,
+				      char *output, const char *alphabet)
+{
+	const __m256i digits =
+	    _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)alphabet));
+	const __m256i nibble_mask = _mm256_set1_epi8(0x0f);
+	size_t input_pos = 0;
+
+	while (input_size - input_pos >= 32) {
+		__m256i in = _mm256_loadu_si256((const __m256i *)(input + input_pos));
+		__m256i hi = _mm256_shuffle_epi8(
+		    digits, _mm256_and_si256(_mm256_srli_epi16(in, 4), nibble_mask));
+		__m256i lo =
+		    _mm256_shuffle_epi8(digits, _mm256_and_si256(in, nibble_mask));
+		__m256i first = _mm256_unpacklo_epi8(hi, lo);
+		__m256i second = _mm256_unpackhi_epi8(hi, lo);
+
+		_mm256_storeu_si256((__m256i *)output,
+				    _mm256_permute2x128_si256(first, second, 0x20));
+		_mm256_storeu_si256((__m256i *)(output + 32),
+				    _mm256_permute2x128_si256(first, second, 0x31));
+
+		input_pos += 32;
+		output += 64;
+	}
+
+	return input_pos + base16_encode_ssse3(input + input_pos,
+					       input_size - input_pos, output,
+					       alphabet);
+}
+
+/**
+ * Select the base16 kernels once, when the library is loaded.
+ */
+__attribute__((constructor)) static void rfc4648_base16_select_kernels(void)
+{
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2")) {
+		rfc4648_base16_decode_kernel = base16_decode_avx2;
+		rfc4648_base16_encode_kernel = base16_encode_avx2;
+	} else if (__builtin_cpu_supports("ssse3")) {
+		rfc4648_base16_decode_kernel = base16_decode_ssse3;
+		rfc4648_base16_encode_kernel = base16_encode_ssse3;
+	} else {
+		rfc4648_base16_decode_kernel = base16_decode_scalar;
+		rfc4648_base16_encode_kernel = base16_encode_scalar;
+	}
+}
@@ -0,0 +1,375 @@
+/*
+ * Dedicated base32 kernels working on whole 40-bit groups, with vectorized
+ * variants for SSSE3 and AVX2 capable CPUs.
+ *
+ * Both base32 alphabets are made up of two runs of consecutive characters
+ * ("A-Z" and "2-7", or "0-9" and "A-V"), so characters are validated and
+ * translated with a pair of range checks instead of a table lookup, which works
+ * the same way for a single character or a whole vector of them.
+ */
+
+#include "rfc4648_kernels_internal.h"
+
+#include <immintrin.h>
+
+#define SSSE3 __attribute__((target("ssse3")))
+#define AVX2 __attribute__((target("avx2")))
+
+__attribute__((visibility("hidden"))) rfc4648_decode_kernel_fn
+    rfc4648_base32_decode_kernel;
+__attribute__((visibility("hidden"))) rfc4648_encode_kernel_fn
+    rfc4648_base32_encode_kernel;
+
+/**
+ * The two runs of consecutive characters making up a base32 alphabet.  The
+ * first run holds the values [0, first_len) and the second one the rest.
+ */
+struct base32_runs {
+	uint8_t first;
+	uint8_t first_len;
+	uint8_t second;
+};
+
+static struct base32_runs base32_alphabet_runs(const char *alphabet)
+{
+	struct base32_runs runs = {(uint8_t)alphabet[0], 1, 0};
+
+	while (runs.first_len < 32 &&
+	       alphabet[runs.first_len] == alphabet[0] + runs.first_len) {
+		runs.first_len++;
+	}
+
+	runs.second = (uint8_t)alphabet[runs.first_len % 32];
+	return runs;
+}
+
+/*
+ * Translate a single character, or'ing anything outside of the alphabet into
+ * @invalid rather than branching on it.
+ */
+static inline uint64_t base32_value(const struct base32_runs *runs, uint8_t c,
+				    unsigned int *invalid)
+{
+	uint8_t first = c - runs->first;
+	uint8_t second = c - runs->second;
+	unsigned int in_first = first < runs->first_len;
+	unsigned int in_second = second < 32 - runs->first_len;
+	uint8_t mask = -(uint8_t)in_first;
+
+	*invalid |= !(in_first | in_second);
+
+	return (first & mask) | ((uint8_t)(second + runs->first_len) & ~mask);
+}
+
+static size_t base32_decode_scalar(const char *input, size_t input_size,
+				   uint8_t *output, const char *alphabet)
+{
+	struct base32_runs runs = base32_alphabet_runs(alphabet);
+	size_t input_pos = 0;
+
+	/* Always leave the final (possibly padded) group to the generic decoder */
+	while (input_size - input_pos >= 16) {
+		const uint8_t *in = (const uint8_t *)input + input_pos;
+		unsigned int invalid = 0;
+		uint64_t group = 0;
+
+		for (int i = 0; i < 8; i++) {
+			group = (group << 5) | base32_value(&runs, in[i], &invalid);
+		}
+
+		if (invalid) {
+			break;
+		}
+
+		output[0] = group >> 32;
+		output[1] = group >> 24;
+		output[2] = group >> 16;
+		output[3] = group >> 8;
+		output[4] = group;
+
+		input_pos += 8;
+		output += 5;
+	}
+
+	return input_pos;
+}
+
+static size_t base32_encode_scalar(const uint8_t *input, size_t input_size,
+				   char *output, const char *alphabet)
+{
+	size_t input_pos = 0;
+
+	while (input_size - input_pos >= 5) {
+		const uint8_t *in = input + input_pos;
+		uint64_t group = (uint64_t)in[0] << 32 | (uint64_t)in[1] << 24 |
+				 (uint64_t)in[2] << 16 | (uint64_t)in[3] << 8 | in[4];
+
+		for (int i = 0; i < 8; i++) {
+			output[i] = alphabet[(group >> (35 - 5 * i)) & 0x1f];
+		}
+
+		input_pos += 5;
+		output += 8;
+	}
+
+	return input_pos;
+}
+
+/*
+ * Translate 16 characters to their 5-bit values, returning a mask of the lanes
+ * which held a character of the alphabet in @valid.
+ */
+SSSE3 static inline __m128i base32_values_sse(__m128i in,
+					      const struct base32_runs *runs,
+					      __m128i *valid)
+{
+	__m128i first = _mm_sub_epi8(in, _mm_set1_epi8(runs->first));
+	__m128i second = _mm_sub_epi8(in, _mm_set1_epi8(runs->second));
+
+	/* Unsigned range checks, as every character of the alphabet is ASCII */
+	__m128i in_first = _mm_cmpeq_epi8(
+	    _mm_min_epu8(first, _mm_set1_epi8(runs->first_len - 1)), first);
+	__m128i in_second = _mm_cmpeq_epi8(
+	    _mm_min_epu8(second, _mm_set1_epi8(31 - runs->first_len)), second);
+
+	*valid = _mm_or_si128(in_first, in_second);
+
+	return _mm_or_si128(
+	    _mm_and_si128(in_first, first),
+	    _mm_and_si128(in_second,
+			  _mm_add_epi8(second, _mm_set1_epi8(runs->first_len))));
+}
+
+/*
+ * Pack the 5-bit values of two groups into 40-bit groups held in the low five
+ * bytes of each 64-bit lane.
+ */
+SSSE3 static inline __m128i base32_pack_sse(__m128i values)
+{
+	/* [v0 v1] -> 10 bits, then [w0 w1] -> 20 bits */
+	values = _mm_maddubs_epi16(values, _mm_set1_epi16(0x0120));
+	values = _mm_madd_epi16(values, _mm_set1_epi32(0x00010400));
+
+	/* Bits above the low five bytes are never stored, so may hold anything */
+	return _mm_or_si128(_mm_srli_epi64(values, 32), _mm_slli_epi64(values, 20));
+}
+
+SSSE3 static size_t base32_decode_ssse3(const char *input, size_t input_size,
+					uint8_t *output, const char *alphabet)
+{
+	const __m128i to_bytes = _mm_setr_epi8(4, 3, 2, 1, 0, 12, 11, 10, 9, 8, -1,
+					       -1, -1, -1, -1, -1);
+	struct base32_runs runs = base32_alphabet_runs(alphabet);
+	size_t input_pos = 0;
+
+	/*
+	 * Each store writes 6 bytes past the two groups, which the 16 characters
+	 * left over for the next iteration or the generic decoder always cover.
+	 */
+	while (input_size - input_pos >= 32) {
+		__m128i valid;
+		__m128i values = base32_values_sse(
+		    _mm_loadu_si128((const __m128i *)(input + input_pos)), &runs,
+		    &valid);
+
+		if (_mm_movemask_epi8(valid) != 0xffff) {
+			break;
+		}
+
+		_mm_storeu_si128((__m128i *)output,
+				 _mm_shuffle_epi8(base32_pack_sse(values), to_bytes));
+
+		input_pos += 16;
+		output += 10;
+	}
+
+	return input_pos + base32_decode_scalar(input + input_pos,
+						input_size - input_pos, output,
+						alphabet);
+}
+
+/*
+ * Each 16-bit word i holds the two bytes covering the i-th 5-bit index of a
+ * group, and multiplying by these and keeping the high half shifts the index to
+ * the bottom of the word.
+ */
+#define BASE32_ENCODE_WORDS                                                        \
+	1, 0, 1, 0, 2, 1, 2, 1, 3, 2, 4, 3, 4, 3, -1, 4
+#define BASE32_ENCODE_SHIFTS 32, 1024, 128, 4096, 512, 64, 2048, 256
+
+/*
+ * Translate 5-bit indexes to characters of the alphabet, looking each one up in
+ * both 16 character halves of it and keeping the right one.
+ */
+SSSE3 static inline __m128i base32_chars_sse(__m128i indexes, __m128i low,
+					     __m128i high)
+{
+	__m128i is_high = _mm_cmpgt_epi8(indexes, _mm_set1_epi8(15));
+
+	return _mm_or_si128(
+	    _mm_andnot_si128(is_high, _mm_shuffle_epi8(low, indexes)),
+	    _mm_and_si128(is_high, _mm_shuffle_epi8(high, indexes)));
+}
+
+SSSE3 static inline __m128i base32_indexes_sse(__m128i in)
+{
+	in = _mm_shuffle_epi8(in, _mm_setr_epi8(BASE32_ENCODE_WORDS));
+	in = _mm_mulhi_epu16(in, _mm_setr_epi16(BASE32_ENCODE_SHIFTS));
+
+	return _mm_and_si128(in, _mm_set1_epi16(0x1f));
+}
+
+SSSE3 static size_t base32_encode_ssse3(const uint8_t *input, size_t input_size,
+					char *output, const char *alphabet)
+{
+	const __m128i low = _mm_loadu_si128((const __m128i *)alphabet);
+	const __m128i high = _mm_loadu_si128((const __m128i *)(alphabet + 16));
+	size_t input_pos = 0;
+
+	/* The second load reads 11 bytes past the two groups being encoded */
+	while (input_size - input_pos >= 21) {
+		const uint8_t *in = input + input_pos;
+		__m128i first =
+		    base32_indexes_sse(_mm_loadu_si128((const __m128i *)in));
+		__m128i second =
+		    base32_indexes_sse(_mm_loadu_si128((const __m128i *)(in + 5)));
+
+		_mm_storeu_si128(
+		    (__m128i *)output,
+		    base32_chars_sse(_mm_packus_epi16(first, second), low, high));
+
+		input_pos += 10;
+		output += 16;
+	}
+
+	return input_pos + base32_encode_scalar(input + input_pos,
+						input_size - input_pos, output,
+						alphabet);
+}
+
+AVX2 static inline __m256i base32_values_avx2(__m256i in,
+					      const struct base32_runs *runs,
+					      __m256i *valid)
+{
+	__m256i first = _mm256_sub_epi8(in, _mm256_set1_epi8(runs->first));
+	__m256i second = _mm256_sub_epi8(in, _mm256_set1_epi8(runs->second));
+
+	__m256i in_first = _mm256_cmpeq_epi8(
+	    _mm256_min_epu8(first, _mm256_set1_epi8(runs->first_len - 1)), first);
+	__m256i in_second = _mm256_cmpeq_epi8(
+	    _mm256_min_epu8(second, _mm256_set1_epi8(31 - runs->first_len)),
+	    second);
+
+	*valid = _mm256_or_si256(in_first, in_second);
+
+	return _mm256_or_si256(
+	    _mm256_and_si256(in_first, first),
+	    _mm256_and_si256(in_second, _mm256_add_epi8(
+					    second, _mm256_set1_epi8(runs->first_len))));
+}
+
+AVX2 static size_t base32_decode_avx2(const char *input, size_t input_size,
+				      uint8_t *output, const char *alphabet)
+{
+	const __m256i to_bytes = _mm256_setr_epi8(
+	    4, 3, 2, 1, 0, 12, 11, 10, 9, 8, -1, -1, -1, -1, -1, -1, 4, 3, 2, 1, 0,
+	    12, 11, 10, 9, 8, -1, -1, -1, -1, -1, -1);
+	struct base32_runs runs = base32_alphabet_runs(alphabet);
+	size_t input_pos = 0;
+
+	while (input_size - input_pos >= 48) {
+		__m256i valid;
+		__m256i values = base32_values_avx2(
+		    _mm256_loadu_si256((const __m256i *)(input + input_pos)), &runs,
+		    &valid);
+
+		if (_mm256_movemask_epi8(valid) != -1) {
+			break;
+		}
+
+		values = _mm256_maddubs_epi16(values, _mm256_set1_epi16(0x0120));
+		values = _mm256_madd_epi16(values, _mm256_set1_epi32(0x00010400));
+		values = _mm256_or_si256(_mm256_srli_epi64(values, 32),
+					 _mm256_slli_epi64(values, 20));
+		values = _mm256_shuffle_epi8(values, to_bytes);
+
+		/* Each lane holds 10 bytes, the second store covers the first's tail */
+		_mm_storeu_si128((__m128i *)output, _mm256_castsi256_si128(values));
+		_mm_storeu_si128((__m128i *)(output + 10),
+				 _mm256_extracti128_si256(values, 1));
+
+		input_pos += 32;
+		output += 20;
+	}
+
+	return input_pos + base32_decode_ssse3(input + input_pos,
+					       input_size - input_pos, output,
+					       alphabet);
+}
+
+AVX2 static inline __m256i base32_indexes_avx2(const uint8_t *lo, const uint8_t *hi)
+{
+	__m256i in = _mm256_inserti128_si256(
+	    _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)lo)),
+	    _mm_loadu_si128((const __m128i *)hi), 1);
+
+	in = _mm256_shuffle_epi8(
+	    in, _mm256_setr_epi8(BASE32_ENCODE_WORDS, BASE32_ENCODE_WORDS));
+	in = _mm256_mulhi_epu16(
+	    in, _mm256_setr_epi16(BASE32_ENCODE_SHIFTS, BASE32_ENCODE_SHIFTS));
+
+	return _mm256_and_si256(in, _mm256_set1_epi16(0x1f));
+}
+
+AVX2 static size_t base32_encode_avx2(const uint8_t *input, size_t input_size,
+				      char *output, const char *alphabet)
+{
+	const __m256i low = _mm256_broadcastsi128_si256(
+	    _mm_loadu_si128((const __m128i *)alphabet));
+	const __m256i high = _mm256_broadcastsi128_si256(
+	    _mm_loadu_si128((const __m128i *)(alphabet + 16)));
+	size_t input_pos = 0;
+
+	while (input_size - input_pos >= 32) {
+		const uint8_t *in = input + input_pos;
+		__m256i first = base32_indexes_avx2(in, in + 5);
+		__m256i second = base32_indexes_avx2(in + 10, in + 15);
+		__m256i indexes = _mm256_permute4x64_epi64(
+		    _mm256_packus_epi16(first, second), 0xd8);
+		__m256i is_high = _mm256_cmpgt_epi8(indexes, _mm256_set1_epi8(15));
+
+		_mm256_storeu_si256(
+		    (__m256i *)output,
+		    _mm256_or_si256(
+			_mm256_andnot_si256(is_high,
+					    _mm256_shuffle_epi8(low, indexes)),
+			_mm256_and_si256(is_high,
+					 _mm256_shuffle_epi8(high, indexes))));
+
+		input_pos += 20;
+		output += 32;
+	}
+
+	return input_pos + base32_encode_ssse3(input + input_pos,
+					       input_size - input_pos, output,
+					       alphabet);
+}
+
+/**
+ * Select the base32 kernels once, when the library is loaded.
+ */
+__attribute__((constructor)) static void rfc4648_base32_select_kernels(void)
+{
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2")) {
+		rfc4648_base32_decode_kernel = base32_decode_avx2;
+		rfc4648_base32_encode_kernel = base32_encode_avx2;
+	} else if (__builtin_cpu_supports("ssse3")) {
+		rfc4648_base32_decode_kernel = base32_decode_ssse3;
+		rfc4648_base32_encode_kernel = base32_encode_ssse3;
+	} else {
+		rfc4648_base32_decode_kernel = base32_decode_scalar;
+		rfc4648_base32_encode_kernel = base32_encode_scalar;
+	}
+}
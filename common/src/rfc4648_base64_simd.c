@@ -0,0 +1,324 @@
+/*
+ * Vectorized base64 kernels for SSSE3 and AVX2 capable CPUs.
+ *
+ * The 6-bit shuffling tricks used here are described by Wojciech Muła and
+ * Daniel Lemire in "Faster Base64 Encoding and Decoding Using AVX2
+ * Instructions" (https://arxiv.org/abs/1704.00605).
+ */
+
+#include "rfc4648_kernels_internal.h"
+
+#include <immintrin.h>
+
+#define SSSE3 __attribute__((target("ssse3")))
+#define AVX2 __attribute__((target("avx2")))
+
+// Only read from within the library, so not exported from it
+__attribute__((visibility("hidden"))) rfc4648_decode_kernel_fn
+    rfc4648_base64_decode_kernel;
+__attribute__((visibility("hidden"))) rfc4648_encode_kernel_fn
+    rfc4648_base64_encode_kernel;
+
+/*
+ * Offsets added to a reduced 6-bit index to produce its alphabet character.
+ * Index 0 is used for "a-z", 1-10 for "0-9", 11 and 12 for the two alphabet
+ * specific characters and 13 for "A-Z".
+ */
+#define BASE64_ENCODE_SHIFTS(c62, c63)                                             \
+	'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,      \
+	    '0' - 52, '0' - 52, '0' - 52, '0' - 52, (char)((c62)-62),              \
+	    (char)((c63)-63), 'A', 0, 0
+
+/*
+ * Without SSSE3 there is nothing to gain over the generic decoder, so consume
+ * nothing and leave all of the work to it.
+ */
+static size_t base64_decode_scalar(const char *input, size_t input_size,
+				   uint8_t *output, const char *alphabet)
+{
+	(void)input;
+	(void)input_size;
+	(void)output;
+	(void)alphabet;
+
+	return 0;
+}
+
+static size_t base64_encode_scalar(const uint8_t *input, size_t input_size,
+				   char *output, const char *alphabet)
+{
+	(void)input;
+	(void)input_size;
+	(void)output;
+	(void)alphabet;
+
+	return 0;
+}
+
+SSSE3 static inline __m128i base64_encode_sse(__m128i in, __m128i shifts)
+{
+	/* [b0 b1 b2] -> [b1 b0 b2 b1] in each 32-bit lane */
+	in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7,
+						10, 9, 11, 10));
+
+	__m128i hi = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)),
+				     _mm_set1_epi32(0x04000040));
+	__m128i lo = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)),
+				     _mm_set1_epi32(0x01000010));
+	__m128i indices = _mm_or_si128(hi, lo);
+
+	__m128i reduced = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+	__m128i upper = _mm_cmplt_epi8(indices, _mm_set1_epi8(26));
+
+	reduced = _mm_or_si128(reduced, _mm_and_si128(upper, _mm_set1_epi8(13)));
+
+	return _mm_add_epi8(indices, _mm_shuffle_epi8(shifts, reduced));
+}
+
+SSSE3 static inline __m128i base64_range_sse(__m128i in, char lo, char hi)
+{
+	return _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8((char)(lo - 1))),
+			     _mm_cmplt_epi8(in, _mm_set1_epi8((char)(hi + 1))));
+}
+
+/*
+ * Translate 16 characters to their 6-bit values, returning a mask of the lanes
+ * which held a valid alphabet character in @valid.
+ */
+SSSE3 static inline __m128i base64_decode_sse(__m128i in, char c62, char c63,
+					      __m128i *valid)
+{
+	__m128i upper = base64_range_sse(in, 'A', 'Z');
+	__m128i lower = base64_range_sse(in, 'a', 'z');
+	__m128i digit = base64_range_sse(in, '0', '9');
+	__m128i is62 = _mm_cmpeq_epi8(in, _mm_set1_epi8(c62));
+	__m128i is63 = _mm_cmpeq_epi8(in, _mm_set1_epi8(c63));
+
+	*valid = _mm_or_si128(_mm_or_si128(upper, lower),
+			      _mm_or_si128(digit, _mm_or_si128(is62, is63)));
+
+	__m128i values =
+	    _mm_and_si128(upper, _mm_add_epi8(in, _mm_set1_epi8(-'A')));
+	values = _mm_or_si128(
+	    values, _mm_and_si128(lower, _mm_add_epi8(in, _mm_set1_epi8(26 - 'a'))));
+	values = _mm_or_si128(
+	    values, _mm_and_si128(digit, _mm_add_epi8(in, _mm_set1_epi8(52 - '0'))));
+	values = _mm_or_si128(values, _mm_and_si128(is62, _mm_set1_epi8(62)));
+	values = _mm_or_si128(values, _mm_and_si128(is63, _mm_set1_epi8(63)));
+
+	return values;
+}
+
+/*
+ * Pack 16 6-bit values into 12 bytes in the low lanes of the result.
+ */
+SSSE3 static inline __m128i base64_pack_sse(__m128i values)
+{
+	__m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+	__m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+
+	return _mm_shuffle_epi8(packed, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14,
+						      13, 12, -1, -1, -1, -1));
+}
+
+SSSE3 static size_t base64_decode_ssse3(const char *input, size_t input_size,
+					uint8_t *output, const char *alphabet)
+{
+	size_t input_pos = 0;
+
+	/*
+	 * Each step stores 16 bytes but only produces 12, so keep at least two
+	 * groups back to ensure the extra stores land inside @output.
+	 */
+	while (input_size - input_pos >= 24) {
+		__m128i valid;
+		__m128i in = _mm_loadu_si128((const __m128i *)(input + input_pos));
+		__m128i values =
+		    base64_decode_sse(in, alphabet[62], alphabet[63], &valid);
+
+		if (_mm_movemask_epi8(valid) != 0xffff) {
+			break;
+		}
+
+		_mm_storeu_si128((__m128i *)output, base64_pack_sse(values));
+
+		input_pos += 16;
+		output += 12;
+	}
+
+	return input_pos;
+}
+
+SSSE3 static size_t base64_encode_ssse3(const uint8_t *input, size_t input_size,
+					char *output, const char *alphabet)
+{
+	__m128i shifts =
+	    _mm_setr_epi8(BASE64_ENCODE_SHIFTS(alphabet[62], alphabet[63]));
+	size_t input_pos = 0;
+
+	while (input_size - input_pos >= 16) {
+		__m128i in = _mm_loadu_si128((const __m128i *)(input + input_pos));
+
+		_mm_storeu_si128((__m128i *)output, base64_encode_sse(in, shifts));
+
+		input_pos += 12;
+		output += 16;
+	}
+
+	return input_pos;
+}
+
+AVX2 static inline __m256i base64_encode_avx2(__m256i in, __m256i shifts)
+{
+	in = _mm256_shuffle_epi8(
+	    in, _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10, 1,
+				 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+
+	__m256i hi =
+	    _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)),
+			       _mm256_set1_epi32(0x04000040));
+	__m256i lo =
+	    _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)),
+			       _mm256_set1_epi32(0x01000010));
+	__m256i indices = _mm256_or_si256(hi, lo);
+
+	__m256i reduced = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+	__m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+
+	reduced =
+	    _mm256_or_si256(reduced, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+
+	return _mm256_add_epi8(indices, _mm256_shuffle_epi8(shifts, reduced));
+}
+
+AVX2 static inline __m256i base64_range_avx2(__m256i in, char lo, char hi)
+{
+	return _mm256_and_si256(
+	    _mm256_cmpgt_epi8(in, _mm256_set1_epi8((char)(lo - 1))),
+	    _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(hi + 1)), in));
+}
+
+AVX2 static inline __m256i base64_decode_avx2(__m256i in, char c62, char c63,
+					      __m256i *valid)
+{
+	__m256i upper = base64_range_avx2(in, 'A', 'Z');
+	__m256i lower = base64_range_avx2(in, 'a', 'z');
+	__m256i digit = base64_range_avx2(in, '0', '9');
+	__m256i is62 = _mm256_cmpeq_epi8(in, _mm256_set1_epi8(c62));
+	__m256i is63 = _mm256_cmpeq_epi8(in, _mm256_set1_epi8(c63));
+
+	*valid = _mm256_or_si256(_mm256_or_si256(upper, lower),
+				 _mm256_or_si256(digit, _mm256_or_si256(is62, is63)));
+
+	__m256i values =
+	    _mm256_and_si256(upper, _mm256_add_epi8(in, _mm256_set1_epi8(-'A')));
+	values = _mm256_or_si256(
+	    values,
+	    _mm256_and_si256(lower, _mm256_add_epi8(in, _mm256_set1_epi8(26 - 'a'))));
+	values = _mm256_or_si256(
+	    values,
+	    _mm256_and_si256(digit, _mm256_add_epi8(in, _mm256_set1_epi8(52 - '0'))));
+	values =
+	    _mm256_or_si256(values, _mm256_and_si256(is62, _mm256_set1_epi8(62)));
+	values =
+	    _mm256_or_si256(values, _mm256_and_si256(is63, _mm256_set1_epi8(63)));
+
+	return values;
+}
+
+/*
+ * Pack 32 6-bit values into 24 bytes in the low lanes of the result.
+ */
+AVX2 static inline __m256i base64_pack_avx2(__m256i values)
+{
+	__m256i merged =
+	    _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+	__m256i packed = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+
+	packed = _mm256_shuffle_epi8(
+	    packed, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1,
+				     -1, -1, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+				     -1, -1, -1, -1));
+
+	return _mm256_permutevar8x32_epi32(packed,
+					   _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+}
+
+AVX2 static size_t base64_decode_avx2_kernel(const char *input, size_t input_size,
+					     uint8_t *output, const char *alphabet)
+{
+	size_t input_pos = 0;
+
+	/*
+	 * Each step stores 32 bytes but only produces 24, so keep at least four
+	 * groups back to ensure the extra stores land inside @output.
+	 */
+	while (input_size - input_pos >= 48) {
+		__m256i valid;
+		__m256i in =
+		    _mm256_loadu_si256((const __m256i *)(input + input_pos));
+		__m256i values =
+		    base64_decode_avx2(in, alphabet[62], alphabet[63], &valid);
+
+		if (_mm256_movemask_epi8(valid) != -1) {
+			break;
+		}
+
+		_mm256_storeu_si256((__m256i *)output, base64_pack_avx2(values));
+
+		input_pos += 32;
+		output += 24;
+	}
+
+	return input_pos + base64_decode_ssse3(input + input_pos,
+					       input_size - input_pos, output,
+					       alphabet);
+}
+
+AVX2 static size_t base64_encode_avx2_kernel(const uint8_t *input,
+					     size_t input_size, char *output,
+					     const char *alphabet)
+{
+	__m256i shifts =
+	    _mm256_setr_epi8(BASE64_ENCODE_SHIFTS(alphabet[62], alphabet[63]),
+			     BASE64_ENCODE_SHIFTS(alphabet[62], alphabet[63]));
+	size_t input_pos = 0;
+
+	/* Each 128-bit lane takes 12 bytes, loaded as 16 */
+	while (input_size - input_pos >= 28) {
+		const uint8_t *in = input + input_pos;
+		__m256i block = _mm256_inserti128_si256(
+		    _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)in)),
+		    _mm_loadu_si128((const __m128i *)(in + 12)), 1);
+
+		_mm256_storeu_si256((__m256i *)output,
+				    base64_encode_avx2(block, shifts));
+
+		input_pos += 24;
+		output += 32;
+	}
+
+	return input_pos + base64_encode_ssse3(input + input_pos,
+					       input_size - input_pos, output,
+					       alphabet);
+}
+
+/**
+ * Select the base64 kernels once, when the library is loaded, so that the
+ * decoding and encoding paths never need to check the CPU features again.
+ */
+__attribute__((constructor)) static void rfc4648_base64_select_kernels(void)
+{
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2")) {
+		rfc4648_base64_decode_kernel = base64_decode_avx2_kernel;
+		rfc4648_base64_encode_kernel = base64_encode_avx2_kernel;
+	} else if (__builtin_cpu_supports("ssse3")) {
+		rfc4648_base64_decode_kernel = base64_decode_ssse3;
+		rfc4648_base64_encode_kernel = base64_encode_ssse3;
+	} else {
+		rfc4648_base64_decode_kernel = base64_decode_scalar;
+		rfc4648_base64_encode_kernel = base64_encode_scalar;
+	}
+}
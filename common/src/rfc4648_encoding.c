@@ -4,10 +4,11 @@
  * See: https://tools.ietf.org/rfc/rfc4648.txt
  */
 
+#include <cryptopal-common.h>
+
 #include "rfc4648_encoding_internal.h"
 
 #include <assert.h>
-#include <ctype.h>
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
@@ -22,228 +23,314 @@ static const char RFC4648_PADDING = '=';
  * base16 uses an index size of 4 bits, to produce 2 output
  * characters for every 8 bits of input.
  */
-static const uint8_t BASE16_OUTPUT_GROUP_BITS = 4;
-static const uint8_t BASE16_INPUT_GROUP_BITS = 8;
+#define BASE16_OUTPUT_GROUP_BITS 4
+#define BASE16_INPUT_GROUP_BITS 8
 
-static const char *BASE16_ALPHABET = "0123456789ABCDEF";
-static char BASE16_DECODE_TABLE[256];
+static const char BASE16_ALPHABET[] = "0123456789ABCDEF";
+static const char BASE16_DECODE_TABLE[256] = {
+    BYTE_TABLE(BASE16_DECODE_ENTRY)};
+
+/**
+ * base16 output using lowercase digits.  Decoding is case-insensitive, so this
+ * shares the decoding table of the uppercase alphabet.
+ */
+static const char BASE16LOWER_ALPHABET[] = "0123456789abcdef";
 
 /**
  * base32 uses an index size of 5 bits, to produce 8 output
  * characters for every 40 bits of input.
  */
-static const uint8_t BASE32_OUTPUT_GROUP_BITS = 5;
-static const uint8_t BASE32_INPUT_GROUP_BITS = 40;
+#define BASE32_OUTPUT_GROUP_BITS 5
+#define BASE32_INPUT_GROUP_BITS 40
 
-static const char *BASE32_ALPHABET = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
-static char BASE32_DECODE_TABLE[256];
+static const char BASE32_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+static const char BASE32_DECODE_TABLE[256] = {
+    BYTE_TABLE(BASE32_DECODE_ENTRY)};
 
 /**
  * A separate base32 encoding scheme, using the "extended hex" alphabet.
  */
-static const char *BASE32HEX_ALPHABET = "0123456789ABCDEFGHIJKLMNOPQRSTUV";
-static char BASE32HEX_DECODE_TABLE[256];
+static const char BASE32HEX_ALPHABET[] = "0123456789ABCDEFGHIJKLMNOPQRSTUV";
+static const char BASE32HEX_DECODE_TABLE[256] = {
+    BYTE_TABLE(BASE32HEX_DECODE_ENTRY)};
 
 /**
  * base64 uses an index size of 6 bits, to produce 4 output
  * characters for every 24 bits of input.
  */
-static const uint8_t BASE64_OUTPUT_GROUP_BITS = 6;
-static const uint8_t BASE64_INPUT_GROUP_BITS = 24;
+#define BASE64_OUTPUT_GROUP_BITS 6
+#define BASE64_INPUT_GROUP_BITS 24
 
-static const char *BASE64_ALPHABET =
+static const char BASE64_ALPHABET[] =
     "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-static char BASE64_DECODE_TABLE[256];
+static const char BASE64_DECODE_TABLE[256] = {
+    BYTE_TABLE(BASE64_DECODE_ENTRY)};
 
 /**
  * A separate base64 encoding scheme, using a filename and URL safe alphabet.
  */
-static const char *BASE64SAFE_ALPHABET =
+static const char BASE64SAFE_ALPHABET[] =
     "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
-static char BASE64SAFE_DECODE_TABLE[256];
+static const char BASE64SAFE_DECODE_TABLE[256] = {
+    BYTE_TABLE(BASE64SAFE_DECODE_ENTRY)};
 
-static void rfc4648_build_decode_table(const char *alphabet, char *decode_table,
-				       int case_insensitive)
+static int rfc4648_decode(const char *input, const size_t input_size,
+			  uint8_t **output, size_t *output_length,
+			  const struct rfc4648_scheme *scheme)
 {
-	for (size_t offset = 0; offset < 256; offset++) {
-		decode_table[offset] = -1;
+	size_t group_chars = scheme->input_group_bits / scheme->output_group_bits;
+
+	if (input == NULL || (input_size % group_chars) != 0) {
+		return -EINVAL;
 	}
 
-	size_t alphabet_len = strnlen(alphabet, 256);
+	size_t output_size = rfc4648_decoded_size(input, input_size, scheme);
+	uint8_t *output_tmp = calloc(sizeof *output_tmp, output_size);
 
-	for (size_t offset = 0; offset < alphabet_len; offset++) {
-		uint8_t val = (uint8_t)alphabet[offset];
+	if (output_tmp == NULL) {
+		return -ENOMEM;
+	}
 
-		if (isalpha(val) && case_insensitive) {
-			uint8_t upperval = toupper(val);
-			uint8_t lowerval = tolower(val);
+	int err = rfc4648_decode_into(input, input_size, output_tmp, &output_size,
+				      scheme);
 
-			decode_table[upperval] = offset;
-			decode_table[lowerval] = offset;
-		} else {
-			decode_table[val] = offset;
-		}
+	if (err < 0) {
+		free(output_tmp);
+		return err;
 	}
+
+	*output = output_tmp;
+	*output_length = output_size;
+	return 0;
 }
 
-static int rfc4648_decode(const char *input, const size_t input_size,
-			  uint8_t **output, size_t *output_length,
-			  const uint8_t input_group_bits,
-			  const uint8_t output_group_bits, const char *decode_table)
+static int rfc4648_decode_into(const char *input, const size_t input_size,
+			       uint8_t *output, size_t *output_size,
+			       const struct rfc4648_scheme *scheme)
 {
-	assert(input_group_bits <= 64);
-	assert(input_group_bits % 8 == 0);
-	assert(output_group_bits < input_group_bits);
+	assert(scheme->input_group_bits <= 64);
+	assert(scheme->input_group_bits % 8 == 0);
+	assert(scheme->output_group_bits < scheme->input_group_bits);
 
-	int err = -1;
-	int output_groups = input_group_bits / output_group_bits;
+	size_t group_chars = scheme->input_group_bits / scheme->output_group_bits;
+	size_t group_bytes = scheme->input_group_bits / 8;
 
-	if (input == NULL || (input_size % output_groups) != 0) {
+	if (input == NULL || output_size == NULL ||
+	    (input_size % group_chars) != 0) {
 		return -EINVAL;
 	}
 
-	size_t output_size =
-	    rfc4648_decoded_size(input_size, input_group_bits, output_group_bits);
-	size_t padding_pos = input_size - 1;
+	size_t decoded_size = rfc4648_decoded_size(input, input_size, scheme);
 
-	while (input[padding_pos--] == RFC4648_PADDING) {
-		output_size--;
+	if (decoded_size > *output_size) {
+		return -ENOSPC;
 	}
 
-	uint8_t *output_tmp = calloc(sizeof *output_tmp, output_size);
+	size_t input_pos = 0;
+	size_t output_pos = 0;
 
-	if (output_tmp == NULL) {
-		return -ENOMEM;
+	if (scheme->decode_kernel != NULL) {
+		input_pos = (*scheme->decode_kernel)(input, input_size, output,
+						     scheme->alphabet);
+		output_pos = input_pos / group_chars * group_bytes;
+	}
+
+	int err = rfc4648_decode_groups(input + input_pos, input_size - input_pos,
+					output + output_pos,
+					decoded_size - output_pos, scheme);
+
+	if (err < 0) {
+		return err;
 	}
 
+	*output_size = decoded_size;
+	return 0;
+}
+
+static int rfc4648_decode_groups(const char *input, const size_t input_size,
+				 uint8_t *output, const size_t output_size,
+				 const struct rfc4648_scheme *scheme)
+{
+	size_t group_chars = scheme->input_group_bits / scheme->output_group_bits;
 	size_t input_pos = 0;
-	uint8_t *output_buffer = output_tmp;
+	size_t output_pos = 0;
+	size_t data_size = input_size;
+
+	// Padding is only valid at the end of the final group, anywhere else it is
+	// rejected by the decode table like any other invalid character
+	while (data_size > 0 && input_size - data_size < group_chars - 1 &&
+	       input[data_size - 1] == RFC4648_PADDING) {
+		data_size--;
+	}
 
 	while (input_pos < input_size) {
-		int input_group_offset = input_group_bits;
-		int output_group_offset = (output_groups - 1) * output_group_bits;
-
+		int input_group_offset = scheme->input_group_bits;
 		uint64_t encoded = 0;
 
-		while (output_group_offset >= 0) {
-			char input_value = input[input_pos++];
-			char value = input_value != RFC4648_PADDING
-					 ? decode_table[(int)input_value]
+		for (size_t offset = 0; offset < group_chars; offset++) {
+			uint8_t input_value = input[input_pos];
+			char value = input_pos++ < data_size
+					 ? scheme->decode_table[input_value]
 					 : 0;
 
 			if (value == -1) {
-				err = -1;
-				goto err;
+				return -EINVAL;
 			}
 
-			encoded += value << output_group_offset;
-			output_group_offset -= output_group_bits;
+			encoded = (encoded << scheme->output_group_bits) |
+				  (uint8_t)value;
 		}
 
-		while (input_group_offset > 0) {
+		while (input_group_offset > 0 && output_pos < output_size) {
 			input_group_offset -= 8;
-			*output_buffer++ = (encoded >> input_group_offset);
+			output[output_pos++] = (encoded >> input_group_offset);
 		}
 	}
 
-	*output = output_tmp;
-	*output_length = output_size;
 	return 0;
-err:
-	free(output_tmp);
-	return err;
 }
 
-static size_t rfc4648_decoded_size(const size_t input_size,
-				   const uint8_t input_group_bits,
-				   const uint8_t output_group_bits)
+static size_t rfc4648_decoded_size(const char *input, const size_t input_size,
+				   const struct rfc4648_scheme *scheme)
 {
-	uint8_t input_group_bytes = input_group_bits / 8;
-	uint8_t output_groups = input_group_bits / output_group_bits;
+	size_t group_chars = scheme->input_group_bits / scheme->output_group_bits;
+	size_t group_bytes = scheme->input_group_bits / 8;
+	size_t padding = 0;
+
+	if (input_size < group_chars) {
+		return 0;
+	}
+
+	while (padding < group_chars - 1 &&
+	       input[input_size - padding - 1] == RFC4648_PADDING) {
+		padding++;
+	}
 
-	return input_size / output_groups * input_group_bytes;
+	/* Only the final group may be padded, and only its data characters count */
+	return (input_size / group_chars - 1) * group_bytes +
+	       (group_chars - padding) * scheme->output_group_bits / 8;
 }
 
 static int rfc4648_encode(const uint8_t *input, const size_t input_size,
 			  char **output, size_t *output_length,
-			  const uint8_t input_group_bits,
-			  const uint8_t output_group_bits, const char *alphabet)
+			  const struct rfc4648_scheme *scheme)
 {
-	// Only allow input groups that can be stored
-	// in a 64 bit int
-	assert(input_group_bits <= 64);
-	assert(input_group_bits % 8 == 0);
-	assert(output_group_bits < input_group_bits);
-	assert(rfc4648_valid_alphabet(alphabet, output_group_bits));
-
 	if (input == NULL) {
 		return -EINVAL;
 	}
 
-	size_t output_size =
-	    rfc4648_encoded_size(input_size, input_group_bits, output_group_bits);
-	char *output_tmp = calloc(sizeof *output_tmp, output_size);
+	size_t output_size = rfc4648_encoded_size(input_size, scheme);
+	char *output_tmp = calloc(sizeof *output_tmp, output_size + 1);
 
 	if (output_tmp == NULL) {
 		return -ENOMEM;
 	}
 
+	int err = rfc4648_encode_into(input, input_size, output_tmp, &output_size,
+				      scheme);
+
+	if (err < 0) {
+		free(output_tmp);
+		return err;
+	}
+
+	output_tmp[output_size++] = '\0';
+	*output = output_tmp;
+	*output_length = output_size;
+	return 0;
+}
+
+static int rfc4648_encode_into(const uint8_t *input, const size_t input_size,
+			       char *output, size_t *output_size,
+			       const struct rfc4648_scheme *scheme)
+{
+	// Only allow input groups that can be stored
+	// in a 64 bit int
+	assert(scheme->input_group_bits <= 64);
+	assert(scheme->input_group_bits % 8 == 0);
+	assert(scheme->output_group_bits < scheme->input_group_bits);
+	assert(rfc4648_valid_alphabet(scheme->alphabet, scheme->output_group_bits));
+
+	if (input == NULL || output_size == NULL) {
+		return -EINVAL;
+	}
+
+	size_t encoded_size = rfc4648_encoded_size(input_size, scheme);
+
+	if (encoded_size > *output_size) {
+		return -ENOSPC;
+	}
+
+	size_t group_chars = scheme->input_group_bits / scheme->output_group_bits;
+	size_t group_bytes = scheme->input_group_bits / 8;
+	size_t input_pos = 0;
+	size_t output_pos = 0;
+
+	if (scheme->encode_kernel != NULL) {
+		input_pos = (*scheme->encode_kernel)(input, input_size, output,
+						     scheme->alphabet);
+		output_pos = input_pos / group_bytes * group_chars;
+	}
+
+	rfc4648_encode_groups(input + input_pos, input_size - input_pos,
+			      output + output_pos, scheme);
+
+	*output_size = encoded_size;
+	return 0;
+}
+
+static void rfc4648_encode_groups(const uint8_t *input, const size_t input_size,
+				  char *output, const struct rfc4648_scheme *scheme)
+{
+	size_t group_chars = scheme->input_group_bits / scheme->output_group_bits;
+	size_t group_bytes = scheme->input_group_bits / 8;
 	size_t input_pos = 0;
-	int output_groups = input_group_bits / output_group_bits;
-	char *output_buffer = output_tmp;
 
 	while (input_pos < input_size) {
-		int input_group_offset = input_group_bits;
-		int output_group_offset = (output_groups - 1) * output_group_bits;
-		int padded_output_groups = -1;
+		size_t group_len = input_size - input_pos < group_bytes
+				       ? input_size - input_pos
+				       : group_bytes;
+		int output_group_offset = scheme->input_group_bits;
 
 		uint64_t encoded = 0;
 
-		// Extract the bits of the input groups into a 64 bit integer
-		while (input_group_offset > 0) {
-			if (input_pos >= input_size) {
-				padded_output_groups =
-				    input_group_offset / output_group_bits;
-				break;
-			}
+		// Extract the bits of the input group into a 64 bit integer,
+		// filling any missing bytes of the final group with zeroes
+		for (size_t offset = 0; offset < group_bytes; offset++) {
+			uint8_t value = offset < group_len ? input[input_pos + offset] : 0;
 
-			uint8_t value = input[input_pos++];
-
-			input_group_offset -= 8;
-			encoded += value << input_group_offset;
+			encoded = (encoded << 8) | value;
 		}
 
-		while (output_group_offset >= 0) {
+		input_pos += group_len;
+
+		size_t data_chars = (group_len * 8 + scheme->output_group_bits - 1) /
+				    scheme->output_group_bits;
+
+		for (size_t offset = 0; offset < group_chars; offset++) {
+			output_group_offset -= scheme->output_group_bits;
+
 			unsigned int alphabet_offset =
 			    (encoded >> output_group_offset) &
-			    GROUP_MASK(output_group_bits);
+			    GROUP_MASK(scheme->output_group_bits);
 
-			if (output_group_offset / output_group_bits <
-			    padded_output_groups) {
-				*output_buffer++ = RFC4648_PADDING;
+			if (offset < data_chars) {
+				*output++ = scheme->alphabet[alphabet_offset];
 			} else {
-				*output_buffer++ = alphabet[alphabet_offset];
+				*output++ = RFC4648_PADDING;
 			}
-
-			output_group_offset -= output_group_bits;
 		}
 	}
-
-	*output_buffer++ = '\0';
-	*output = output_tmp;
-	*output_length = output_size;
-	return 0;
 }
 
 static size_t rfc4648_encoded_size(const size_t input_size,
-				   const uint8_t input_group_bits,
-				   const uint8_t output_group_bits)
+				   const struct rfc4648_scheme *scheme)
 {
-	uint8_t output_groups = input_group_bits / output_group_bits;
-	uint8_t input_group_bytes = input_group_bits / 8;
-	uint8_t input_groups = (input_size - 1) / input_group_bytes;
+	size_t output_groups = scheme->input_group_bits / scheme->output_group_bits;
+	size_t input_group_bytes = scheme->input_group_bits / 8;
+	size_t input_groups = (input_size + input_group_bytes - 1) / input_group_bytes;
 
-	return input_groups * output_groups + output_groups + 1;
+	return input_groups * output_groups;
 }
 
 static int rfc4648_valid_alphabet(const char *alphabet, uint8_t output_group_bits)
@@ -254,92 +341,236 @@ static int rfc4648_valid_alphabet(const char *alphabet, uint8_t output_group_bit
 	return alphabet_len == expected_alphabet_len;
 }
 
-size_t cpal_base16_encode(const uint8_t *input, const size_t input_size,
-			  char **output, size_t *output_size)
+static const struct rfc4648_scheme BASE16_SCHEME = {
+    BASE16_INPUT_GROUP_BITS,	   BASE16_OUTPUT_GROUP_BITS,
+    BASE16_ALPHABET,		   BASE16_DECODE_TABLE,
+    &rfc4648_base16_decode_kernel, &rfc4648_base16_encode_kernel};
+
+static const struct rfc4648_scheme BASE16LOWER_SCHEME = {
+    BASE16_INPUT_GROUP_BITS,	   BASE16_OUTPUT_GROUP_BITS,
+    BASE16LOWER_ALPHABET,	   BASE16_DECODE_TABLE,
+    &rfc4648_base16_decode_kernel, &rfc4648_base16_encode_kernel};
+
+static const struct rfc4648_scheme BASE32_SCHEME = {
+    BASE32_INPUT_GROUP_BITS,	   BASE32_OUTPUT_GROUP_BITS,
+    BASE32_ALPHABET,		   BASE32_DECODE_TABLE,
+    &rfc4648_base32_decode_kernel, &rfc4648_base32_encode_kernel};
+
+static const struct rfc4648_scheme BASE32HEX_SCHEME = {
+    BASE32_INPUT_GROUP_BITS,	   BASE32_OUTPUT_GROUP_BITS,
+    BASE32HEX_ALPHABET,		   BASE32HEX_DECODE_TABLE,
+    &rfc4648_base32_decode_kernel, &rfc4648_base32_encode_kernel};
+
+static const struct rfc4648_scheme BASE64_SCHEME = {
+    BASE64_INPUT_GROUP_BITS,	   BASE64_OUTPUT_GROUP_BITS,
+    BASE64_ALPHABET,		   BASE64_DECODE_TABLE,
+    &rfc4648_base64_decode_kernel, &rfc4648_base64_encode_kernel};
+
+static const struct rfc4648_scheme BASE64SAFE_SCHEME = {
+    BASE64_INPUT_GROUP_BITS,	   BASE64_OUTPUT_GROUP_BITS,
+    BASE64SAFE_ALPHABET,	   BASE64SAFE_DECODE_TABLE,
+    &rfc4648_base64_decode_kernel, &rfc4648_base64_encode_kernel};
+
+int cpal_base16_encode(const uint8_t *input, const size_t input_size, char **output,
+		       size_t *output_size)
 {
 	return rfc4648_encode(input, input_size, output, output_size,
-			      BASE16_INPUT_GROUP_BITS, BASE16_OUTPUT_GROUP_BITS,
-			      BASE16_ALPHABET);
+			      &BASE16_SCHEME);
 }
 
-size_t cpal_base16_decode(const char *input, const size_t input_size,
-			  uint8_t **output, size_t *output_size)
+int cpal_base16_encode_into(const uint8_t *input, const size_t input_size,
+			    char *output, size_t *output_size)
 {
-	INITIALIZE_DECODE_TABLE(BASE16_ALPHABET, BASE16_DECODE_TABLE, 1);
+	return rfc4648_encode_into(input, input_size, output, output_size,
+				   &BASE16_SCHEME);
+}
+
+size_t cpal_base16_encoded_len(const size_t input_size)
+{
+	return rfc4648_encoded_size(input_size, &BASE16_SCHEME);
+}
 
+int cpal_base16_decode(const char *input, const size_t input_size, uint8_t **output,
+		       size_t *output_size)
+{
 	return rfc4648_decode(input, input_size, output, output_size,
-			      BASE16_INPUT_GROUP_BITS, BASE16_OUTPUT_GROUP_BITS,
-			      BASE16_DECODE_TABLE);
+			      &BASE16_SCHEME);
 }
 
-size_t cpal_base32_encode(const uint8_t *input, const size_t input_size,
-			  char **output, size_t *output_size)
+int cpal_base16_decode_into(const char *input, const size_t input_size,
+			    uint8_t *output, size_t *output_size)
+{
+	return rfc4648_decode_into(input, input_size, output, output_size,
+				   &BASE16_SCHEME);
+}
+
+size_t cpal_base16_decoded_len(const char *input, const size_t input_size)
+{
+	return rfc4648_decoded_size(input, input_size, &BASE16_SCHEME);
+}
+
+int cpal_base32_encode(const uint8_t *input, const size_t input_size, char **output,
+		       size_t *output_size)
 {
 	return rfc4648_encode(input, input_size, output, output_size,
-			      BASE32_INPUT_GROUP_BITS, BASE32_OUTPUT_GROUP_BITS,
-			      BASE32_ALPHABET);
+			      &BASE32_SCHEME);
 }
 
-size_t cpal_base32_decode(const char *input, const size_t input_size,
-			  uint8_t **output, size_t *output_size)
+int cpal_base32_encode_into(const uint8_t *input, const size_t input_size,
+			    char *output, size_t *output_size)
 {
-	INITIALIZE_DECODE_TABLE(BASE32_ALPHABET, BASE32_DECODE_TABLE, 0);
+	return rfc4648_encode_into(input, input_size, output, output_size,
+				   &BASE32_SCHEME);
+}
 
+size_t cpal_base32_encoded_len(const size_t input_size)
+{
+	return rfc4648_encoded_size(input_size, &BASE32_SCHEME);
+}
+
+int cpal_base32_decode(const char *input, const size_t input_size, uint8_t **output,
+		       size_t *output_size)
+{
 	return rfc4648_decode(input, input_size, output, output_size,
-			      BASE32_INPUT_GROUP_BITS, BASE32_OUTPUT_GROUP_BITS,
-			      BASE32_DECODE_TABLE);
+			      &BASE32_SCHEME);
+}
+
+int cpal_base32_decode_into(const char *input, const size_t input_size,
+			    uint8_t *output, size_t *output_size)
+{
+	return rfc4648_decode_into(input, input_size, output, output_size,
+				   &BASE32_SCHEME);
+}
+
+size_t cpal_base32_decoded_len(const char *input, const size_t input_size)
+{
+	return rfc4648_decoded_size(input, input_size, &BASE32_SCHEME);
 }
 
-size_t cpal_base32hex_encode(const uint8_t *input, const size_t input_size,
-			     char **output, size_t *output_size)
+int cpal_base32hex_encode(const uint8_t *input, const size_t input_size,
+			  char **output, size_t *output_size)
 {
 	return rfc4648_encode(input, input_size, output, output_size,
-			      BASE32_INPUT_GROUP_BITS, BASE32_OUTPUT_GROUP_BITS,
-			      BASE32HEX_ALPHABET);
+			      &BASE32HEX_SCHEME);
 }
 
-size_t cpal_base32hex_decode(const char *input, const size_t input_size,
-			     uint8_t **output, size_t *output_size)
+int cpal_base32hex_encode_into(const uint8_t *input, const size_t input_size,
+			       char *output, size_t *output_size)
 {
-	INITIALIZE_DECODE_TABLE(BASE32HEX_ALPHABET, BASE32HEX_DECODE_TABLE, 1);
+	return rfc4648_encode_into(input, input_size, output, output_size,
+				   &BASE32HEX_SCHEME);
+}
 
+size_t cpal_base32hex_encoded_len(const size_t input_size)
+{
+	return rfc4648_encoded_size(input_size, &BASE32HEX_SCHEME);
+}
+
+int cpal_base32hex_decode(const char *input, const size_t input_size,
+			  uint8_t **output, size_t *output_size)
+{
 	return rfc4648_decode(input, input_size, output, output_size,
-			      BASE32_INPUT_GROUP_BITS, BASE32_OUTPUT_GROUP_BITS,
-			      BASE32HEX_DECODE_TABLE);
+			      &BASE32HEX_SCHEME);
 }
 
-size_t cpal_base64_encode(const uint8_t *input, const size_t input_size,
-			  char **output, size_t *output_size)
+int cpal_base32hex_decode_into(const char *input, const size_t input_size,
+			       uint8_t *output, size_t *output_size)
+{
+	return rfc4648_decode_into(input, input_size, output, output_size,
+				   &BASE32HEX_SCHEME);
+}
+
+size_t cpal_base32hex_decoded_len(const char *input, const size_t input_size)
+{
+	return rfc4648_decoded_size(input, input_size, &BASE32HEX_SCHEME);
+}
+
+int cpal_base64_encode(const uint8_t *input, const size_t input_size, char **output,
+		       size_t *output_size)
 {
 	return rfc4648_encode(input, input_size, output, output_size,
-			      BASE64_INPUT_GROUP_BITS, BASE64_OUTPUT_GROUP_BITS,
-			      BASE64_ALPHABET);
+			      &BASE64_SCHEME);
 }
 
-size_t cpal_base64_decode(const char *input, const size_t input_size,
-			  uint8_t **output, size_t *output_size)
+int cpal_base64_encode_into(const uint8_t *input, const size_t input_size,
+			    char *output, size_t *output_size)
 {
-	INITIALIZE_DECODE_TABLE(BASE64_ALPHABET, BASE64_DECODE_TABLE, 0);
+	return rfc4648_encode_into(input, input_size, output, output_size,
+				   &BASE64_SCHEME);
+}
 
+size_t cpal_base64_encoded_len(const size_t input_size)
+{
+	return rfc4648_encoded_size(input_size, &BASE64_SCHEME);
+}
+
+int cpal_base64_decode(const char *input, const size_t input_size, uint8_t **output,
+		       size_t *output_size)
+{
 	return rfc4648_decode(input, input_size, output, output_size,
-			      BASE64_INPUT_GROUP_BITS, BASE64_OUTPUT_GROUP_BITS,
-			      BASE64_DECODE_TABLE);
+			      &BASE64_SCHEME);
+}
+
+int cpal_base64_decode_into(const char *input, const size_t input_size,
+			    uint8_t *output, size_t *output_size)
+{
+	return rfc4648_decode_into(input, input_size, output, output_size,
+				   &BASE64_SCHEME);
+}
+
+size_t cpal_base64_decoded_len(const char *input, const size_t input_size)
+{
+	return rfc4648_decoded_size(input, input_size, &BASE64_SCHEME);
 }
 
-size_t cpal_base64safe_encode(const uint8_t *input, const size_t input_size,
-			      char **output, size_t *output_size)
+int cpal_base64safe_encode(const uint8_t *input, const size_t input_size,
+			   char **output, size_t *output_size)
 {
 	return rfc4648_encode(input, input_size, output, output_size,
-			      BASE64_INPUT_GROUP_BITS, BASE64_OUTPUT_GROUP_BITS,
-			      BASE64SAFE_ALPHABET);
+			      &BASE64SAFE_SCHEME);
 }
 
-size_t cpal_base64safe_decode(const char *input, const size_t input_size,
-			      uint8_t **output, size_t *output_size)
+int cpal_base64safe_encode_into(const uint8_t *input, const size_t input_size,
+				char *output, size_t *output_size)
 {
-	INITIALIZE_DECODE_TABLE(BASE64SAFE_ALPHABET, BASE64SAFE_DECODE_TABLE, 0);
+	return rfc4648_encode_into(input, input_size, output, output_size,
+				   &BASE64SAFE_SCHEME);
+}
 
+size_t cpal_base64safe_encoded_len(const size_t input_size)
+{
+	return rfc4648_encoded_size(input_size, &BASE64SAFE_SCHEME);
+}
+
+int cpal_base64safe_decode(const char *input, const size_t input_size,
+			   uint8_t **output, size_t *output_size)
+{
 	return rfc4648_decode(input, input_size, output, output_size,
-			      BASE64_INPUT_GROUP_BITS, BASE64_OUTPUT_GROUP_BITS,
-			      BASE64SAFE_DECODE_TABLE);
+			      &BASE64SAFE_SCHEME);
+}
+
+int cpal_base64safe_decode_into(const char *input, const size_t input_size,
+				uint8_t *output, size_t *output_size)
+{
+	return rfc4648_decode_into(input, input_size, output, output_size,
+				   &BASE64SAFE_SCHEME);
+}
+
+size_t cpal_base64safe_decoded_len(const char *input, const size_t input_size)
+{
+	return rfc4648_decoded_size(input, input_size, &BASE64SAFE_SCHEME);
+}
+
+int cpal_base16_encode_lowercase(const uint8_t *input, const size_t input_size,
+				 char **output, size_t *output_size)
+{
+	return rfc4648_encode(input, input_size, output, output_size,
+			      &BASE16LOWER_SCHEME);
+}
+
+int cpal_base16_encode_lowercase_into(const uint8_t *input, const size_t input_size,
+				      char *output, size_t *output_size)
+{
+	return rfc4648_encode_into(input, input_size, output, output_size,
+				   &BASE16LOWER_SCHEME);
 }
@@ -1,106 +1,213 @@
 #ifndef CRYPTOPAL_ENCODING_INTERNAL_H
 #define CRYPTOPAL_ENCODING_INTERNAL_H
 
+#include "rfc4648_kernels_internal.h"
+
 #include <stdint.h>
 #include <stddef.h>
 
 #define GROUP_MASK(x) ((1 << x) - 1)
 
-#define INITIALIZE_DECODE_TABLE(alphabet, decode_table, case_insensitive)          \
-	do {                                                                       \
-		static int decode_table_initialized = 0;                           \
-		if (!decode_table_initialized) {                                   \
-			rfc4648_build_decode_table(alphabet, decode_table,         \
-						   case_insensitive);              \
-			decode_table_initialized = 1;                              \
-		}                                                                  \
-	} while (0);
-
 /**
- * Initialize a decoding table used to map bytes to their offsets in the encoding
- * scheme alphabet.
- *
- * @alphabet The alphabet to initialize the decoding table with.
- * @decode_table The decoding table to initialize.
- * @case_insensitive A flag indiciating whether the encoding scheme the decode
- * table is for is case-insensitive.  If true, then treat uppercase and lowercase
- * characters as having the same value.
+ * Description of an RFC 4648 encoding scheme.
+ *
+ * @input_group_bits The number of bits in an input unit.
+ * @output_group_bits The number of bits which represent a single encoded
+ * character from the alphabet.
+ * @alphabet A string representing the alphabet of the encoding scheme.
+ * @decode_table A table of 256 elements used to map a character value to an
+ * alphabet offset.
+ * @decode_kernel The dispatched bulk decoding kernel for this scheme, or NULL if
+ * the generic decoder handles all of the input.
+ * @encode_kernel The dispatched bulk encoding kernel for this scheme, or NULL if
+ * the generic encoder handles all of the input.
  */
-static void rfc4648_build_decode_table(const char *alphabet, char *decode_table,
-				       int case_insensitive);
+struct rfc4648_scheme {
+	uint8_t input_group_bits;
+	uint8_t output_group_bits;
+	const char *alphabet;
+	const char *decode_table;
+	rfc4648_decode_kernel_fn *decode_kernel;
+	rfc4648_encode_kernel_fn *encode_kernel;
+};
+
+/*
+ * Expand @entry once for every byte value, in order, so that 256 element lookup
+ * tables can be built as constant data at compile time.
+ */
+#define BYTE_TABLE_4(entry, n) entry(n) entry(n + 1) entry(n + 2) entry(n + 3)
+#define BYTE_TABLE_16(entry, n)                                                    \
+	BYTE_TABLE_4(entry, n) BYTE_TABLE_4(entry, n + 4)                          \
+	    BYTE_TABLE_4(entry, n + 8) BYTE_TABLE_4(entry, n + 12)
+#define BYTE_TABLE_64(entry, n)                                                    \
+	BYTE_TABLE_16(entry, n) BYTE_TABLE_16(entry, n + 16)                       \
+	    BYTE_TABLE_16(entry, n + 32) BYTE_TABLE_16(entry, n + 48)
+#define BYTE_TABLE(entry)                                                          \
+	BYTE_TABLE_64(entry, 0) BYTE_TABLE_64(entry, 64)                           \
+	    BYTE_TABLE_64(entry, 128) BYTE_TABLE_64(entry, 192)
+
+#define IN_RANGE(c, lo, hi) ((c) >= (lo) && (c) <= (hi))
+
+/*
+ * Decode table entries, mapping a character to its offset in the alphabet of
+ * each encoding scheme, or -1 if it isn't part of the alphabet.
+ */
+#define BASE16_DECODE_ENTRY(c)                                                     \
+	(IN_RANGE(c, '0', '9')	 ? (c) - '0'                                       \
+	 : IN_RANGE(c, 'A', 'F') ? (c) - 'A' + 10                                  \
+	 : IN_RANGE(c, 'a', 'f') ? (c) - 'a' + 10                                  \
+				 : -1),
+
+#define BASE32_DECODE_ENTRY(c)                                                     \
+	(IN_RANGE(c, 'A', 'Z')	 ? (c) - 'A'                                       \
+	 : IN_RANGE(c, '2', '7') ? (c) - '2' + 26                                  \
+				 : -1),
+
+#define BASE32HEX_DECODE_ENTRY(c)                                                  \
+	(IN_RANGE(c, '0', '9')	 ? (c) - '0'                                       \
+	 : IN_RANGE(c, 'A', 'V') ? (c) - 'A' + 10                                  \
+	 : IN_RANGE(c, 'a', 'v') ? (c) - 'a' + 10                                  \
+				 : -1),
+
+#define BASE64_COMMON_DECODE_ENTRY(c, c62, c63)                                    \
+	(IN_RANGE(c, 'A', 'Z')	 ? (c) - 'A'                                       \
+	 : IN_RANGE(c, 'a', 'z') ? (c) - 'a' + 26                                  \
+	 : IN_RANGE(c, '0', '9') ? (c) - '0' + 52                                  \
+	 : (c) == (c62)		 ? 62                                              \
+	 : (c) == (c63)		 ? 63                                              \
+				 : -1),
+
+#define BASE64_DECODE_ENTRY(c) BASE64_COMMON_DECODE_ENTRY(c, '+', '/')
+#define BASE64SAFE_DECODE_ENTRY(c) BASE64_COMMON_DECODE_ENTRY(c, '-', '_')
 
 /**
  * Decode an @input_size string from @input encoded with the given RFC 4648 encoding
- * scheme.
+ * @scheme.  The bulk of the input is handed to the scheme's decoding kernel when
+ * it has one, and whatever the kernel leaves behind (at least the final, possibly
+ * padded, group) is decoded one group at a time.
  *
  * @input The string to be decoded.
  * @input_size The length of the string to decode.
  * @output [out] The object to store the decoded data in.
- * @input_group_bits The number of bits in an input unit.
- * @output_group_bits The number of bits which represent a single encoded
- * character from the alphabet.
- * @decode_table A table of 255 elements used to map a character value to an
- * alphabet offset.
+ * @output_size [out] The location to store the length of the decoded data in.
+ * @scheme The encoding scheme @input was encoded with.
  *
- * @return A positive result indiciating the length of the decoded data, or a
- * negated error code.
+ * @return 0 if successful, or a negated error code.
  */
 static int rfc4648_decode(const char *input, const size_t input_size,
 			  uint8_t **output, size_t *output_size,
-			  const uint8_t input_group_bits,
-			  const uint8_t output_group_bits,
-			  const char *decode_table);
+			  const struct rfc4648_scheme *scheme);
 
 /**
- * Calculate the expected size for the decoded data with the given @input_size
- * and RFC 4648 encoding scheme @input_group_bits and @output_group_bits.
+ * Decode an @input_size string from @input encoded with the given RFC 4648 encoding
+ * @scheme into the caller supplied @output buffer.
  *
+ * @input The string to be decoded.
+ * @input_size The length of the string to decode.
+ * @output [out] The location to store the decoded data in.
+ * @output_size [in,out] The capacity of @output on entry, and the length of the
+ * decoded data on successful return.
+ * @scheme The encoding scheme @input was encoded with.
+ *
+ * @return 0 if successful, -ENOSPC if @output is too small, or another negated
+ * error code.
+ */
+static int rfc4648_decode_into(const char *input, const size_t input_size,
+			       uint8_t *output, size_t *output_size,
+			       const struct rfc4648_scheme *scheme);
+
+/**
+ * Decode whole groups from @input into @output one group at a time, treating the
+ * padding characters of the final group as zero bits.
+ *
+ * @input The string to be decoded.
+ * @input_size The length of the string to decode, a multiple of the group size.
+ * @output [out] The location to store the decoded data in.
+ * @output_size The number of bytes to store in @output.  Bytes of the final group
+ * beyond this are dropped.
+ * @scheme The encoding scheme @input was encoded with.
+ *
+ * @return 0 if successful, or -EINVAL if a character is not in the alphabet.
+ */
+static int rfc4648_decode_groups(const char *input, const size_t input_size,
+				 uint8_t *output, const size_t output_size,
+				 const struct rfc4648_scheme *scheme);
+
+/**
+ * Calculate the expected size for the decoded data in @input, taking the padding
+ * of the final group into account.
+ *
+ * @input The encoded data.
  * @input_size The number of bytes in the encoded data.
- * @input_group_bits The number of bits in an input group.
- * @output_group_bits The number of bits used to represent an index in the alphabet.
+ * @scheme The encoding scheme @input was encoded with.
  *
  * @return The expected size of the decoded data.
  */
-static size_t rfc4648_decoded_size(const size_t input_size,
-				   const uint8_t input_group_bits,
-				   const uint8_t output_group_bits);
+static size_t rfc4648_decoded_size(const char *input, const size_t input_size,
+				   const struct rfc4648_scheme *scheme);
 
 /**
  * Encode an @input_size range of bytes from @input using an RFC 4648 encoding
- * scheme given input/output group sizes and an alphabet.  After encoding, store the
- * result as a NULL-terminated string in @output. For every @input_group_bits
- * bits of input, there will be (@input_group_bits / @output_group_bits)
- * characters of output.
+ * @scheme.  After encoding, store the result as a NULL-terminated string in
+ * @output. For every input group of the scheme there will be
+ * (input_group_bits / output_group_bits) characters of output.
  *
  * @input The data to be encoded.
  * @input_size The number of bytes to be encoded from @input.
  * @output [out] The object to store the encoded result in.
- * @input_group_bits The number of bits in an input unit.
- * @output_group_bits The number of bits which represent a single encoded
- * character from the alphabet.
- * @alphabet A string representing the alphabet of the encoding scheme.  Must
- * contain exactly 2^output_group_bits elements.
+ * @output_size [out] The location to store the size of the encoded result in,
+ * including the NULL terminator.
+ * @scheme The encoding scheme to encode @input with.  The alphabet must contain
+ * exactly 2^output_group_bits elements.
  *
- * @return A positive result indiciating the length of the encoded data, or a
- * negated error code.
+ * @return 0 if successful, or a negated error code.
  */
 static int rfc4648_encode(const uint8_t *input, const size_t input_size,
 			  char **output, size_t *output_size,
-			  const uint8_t input_group_bits,
-			  const uint8_t output_group_bits, const char *alphabet);
+			  const struct rfc4648_scheme *scheme);
+
+/**
+ * Encode an @input_size range of bytes from @input using an RFC 4648 encoding
+ * @scheme into the caller supplied @output buffer.  No NULL terminator is
+ * written.
+ *
+ * @input The data to be encoded.
+ * @input_size The number of bytes to be encoded from @input.
+ * @output [out] The location to store the encoded characters in.
+ * @output_size [in,out] The capacity of @output on entry, and the number of
+ * characters written on successful return.
+ * @scheme The encoding scheme to encode @input with.
+ *
+ * @return 0 if successful, -ENOSPC if @output is too small, or another negated
+ * error code.
+ */
+static int rfc4648_encode_into(const uint8_t *input, const size_t input_size,
+			       char *output, size_t *output_size,
+			       const struct rfc4648_scheme *scheme);
 
 /**
- * Calculate the expected size for an encoded buffer of with the given
- * @input_group_bits and @output_group_bits.  Use integer division to avoid floating
- * point operations.
+ * Encode @input one group at a time, padding the final group if @input_size is
+ * not a multiple of the input group size.
+ *
+ * @input The data to be encoded.
+ * @input_size The number of bytes to be encoded from @input.
+ * @output [out] The location to store the encoded characters in.
+ * @scheme The encoding scheme to encode @input with.
+ */
+static void rfc4648_encode_groups(const uint8_t *input, const size_t input_size,
+				  char *output,
+				  const struct rfc4648_scheme *scheme);
+
+/**
+ * Calculate the expected number of characters for an encoded buffer of
+ * @input_size bytes, excluding any NULL terminator.  Use integer division to
+ * avoid floating point operations.
  *
  * @input_size The number of bytes of input.
- * @input_group_bits The number of bits in an input group.
- * @output_group_bits The number of bits used to represent an index in the alphabet.
+ * @scheme The encoding scheme the input will be encoded with.
  */
 static size_t rfc4648_encoded_size(const size_t input_size,
-				   const uint8_t input_group_bits,
-				   const uint8_t output_group_bits);
+				   const struct rfc4648_scheme *scheme);
 
 /**
  * Check if the @alphabet contains the correct number of elements
@@ -0,0 +1,61 @@
+#ifndef CRYPTOPAL_RFC4648_KERNELS_INTERNAL_H
+#define CRYPTOPAL_RFC4648_KERNELS_INTERNAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * A bulk decoding kernel.  Decodes as many whole groups from the start of
+ * @input as it can handle and returns the number of characters consumed.  For
+ * schemes with padding the final group of @input is never consumed, so padding is
+ * always left for the generic decoder to handle.  A kernel stops early (and leaves
+ * the remaining input untouched) when it encounters a character outside the
+ * alphabet.
+ *
+ * @input The encoded characters.
+ * @input_size The number of characters in @input.
+ * @output [out] The location to store the decoded bytes in.
+ * @alphabet The alphabet of the encoding scheme.
+ *
+ * @return The number of characters consumed, always a multiple of the group size.
+ */
+typedef size_t (*rfc4648_decode_kernel_fn)(const char *input, size_t input_size,
+					   uint8_t *output, const char *alphabet);
+
+/**
+ * A bulk encoding kernel.  Encodes as many whole groups from the start of @input
+ * as it can handle and returns the number of bytes consumed.  No padding is ever
+ * written by a kernel.
+ *
+ * @input The data to encode.
+ * @input_size The number of bytes in @input.
+ * @output [out] The location to store the encoded characters in.
+ * @alphabet The alphabet of the encoding scheme.
+ *
+ * @return The number of bytes consumed, always a multiple of the group size.
+ */
+typedef size_t (*rfc4648_encode_kernel_fn)(const uint8_t *input, size_t input_size,
+					   char *output, const char *alphabet);
+
+/**
+ * The base64 kernels best suited to the running CPU.  Selected once when the
+ * library is loaded and shared between the base64 and base64safe alphabets.
+ */
+extern rfc4648_decode_kernel_fn rfc4648_base64_decode_kernel;
+extern rfc4648_encode_kernel_fn rfc4648_base64_encode_kernel;
+
+/**
+ * The base16 kernels best suited to the running CPU.  Decoding accepts either
+ * case, and encoding uses the case of the alphabet it is given.
+ */
+extern rfc4648_decode_kernel_fn rfc4648_base16_decode_kernel;
+extern rfc4648_encode_kernel_fn rfc4648_base16_encode_kernel;
+
+/**
+ * The base32 kernels best suited to the running CPU, shared between the base32
+ * and base32hex alphabets.
+ */
+extern rfc4648_decode_kernel_fn rfc4648_base32_decode_kernel;
+extern rfc4648_encode_kernel_fn rfc4648_base32_encode_kernel;
+
+#endif
@@ -0,0 +1,392 @@
+/*
+ * Multi-threaded RFC 4648 encoding and decoding of large buffers.
+ *
+ * Groups are independent of each other, so the input is split at group
+ * boundaries into one slice per thread of a pool, and every slice is handed to
+ * the one-shot _into function of the scheme, writing straight into its own part
+ * of the caller's output buffer.  The variants taking a thread count run on a
+ * pool of their own for the duration of the call.
+ */
+
+#include <cryptopal-common.h>
+
+#include <errno.h>
+#include <unistd.h>
+
+/**
+ * The smallest slice of input worth handing to a thread of its own.  Anything
+ * smaller is dominated by the cost of handing it over.
+ */
+#define RFC4648_PARALLEL_MIN_SLICE (256 * 1024)
+
+#define RFC4648_PARALLEL_MAX_SLICES 256
+
+/**
+ * A contiguous run of whole groups, and the part of the output they decode or
+ * encode to.
+ */
+struct rfc4648_slice {
+	int (*decode_into)(const char *, const size_t, uint8_t *, size_t *);
+	int (*encode_into)(const uint8_t *, const size_t, char *, size_t *);
+	const void *input;
+	size_t input_size;
+	void *output;
+	size_t output_size;
+	int err;
+};
+
+static void rfc4648_slice_run(struct rfc4648_slice *slice)
+{
+	size_t written = slice->output_size;
+
+	if (slice->decode_into != NULL) {
+		slice->err = slice->decode_into(slice->input, slice->input_size,
+						slice->output, &written);
+	} else {
+		slice->err = slice->encode_into(slice->input, slice->input_size,
+						slice->output, &written);
+	}
+
+	// Padding in the middle of the input makes a slice come up short
+	if (slice->err == 0 && written != slice->output_size) {
+		slice->err = -EINVAL;
+	}
+}
+
+static void rfc4648_slices_run(void *arg, size_t begin, size_t end)
+{
+	struct rfc4648_slice *slices = arg;
+
+	for (size_t idx = begin; idx < end; idx++) {
+		rfc4648_slice_run(&slices[idx]);
+	}
+}
+
+/**
+ * Pick the number of slices to split @groups groups of @group_size input bytes
+ * into, given the number of @threads to run them on (0 for one per online CPU).
+ */
+static size_t rfc4648_slice_count(size_t groups, size_t group_size,
+				  unsigned int threads)
+{
+	size_t slices = threads;
+	size_t max_slices = groups * group_size / RFC4648_PARALLEL_MIN_SLICE;
+
+	if (slices == 0) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		slices = cpus > 0 ? (size_t)cpus : 1;
+	}
+
+	if (slices > max_slices) {
+		slices = max_slices;
+	}
+
+	if (slices > RFC4648_PARALLEL_MAX_SLICES) {
+		slices = RFC4648_PARALLEL_MAX_SLICES;
+	}
+
+	return slices > 0 ? slices : 1;
+}
+
+/**
+ * Split @input into slices of whole groups and run them on @pool, or on a pool
+ * of its own of @threads threads when @pool is NULL.  The final slice gets any
+ * remainder, including a partial or padded final group.
+ */
+static int rfc4648_run_slices(struct rfc4648_slice *template,
+			      struct cpal_pool *pool, unsigned int threads,
+			      size_t group_size, size_t output_group_size)
+{
+	struct rfc4648_slice slices[RFC4648_PARALLEL_MAX_SLICES];
+	struct cpal_pool *own_pool = NULL;
+	size_t groups = template->input_size / group_size;
+	size_t slice_count;
+	int err = 0;
+
+	if (pool != NULL) {
+		threads = cpal_pool_threads(pool);
+	}
+
+	slice_count = rfc4648_slice_count(groups, group_size, threads);
+
+	// Not worth a pool, or it couldn't be created, so run on this thread
+	if (pool == NULL && slice_count > 1 &&
+	    cpal_pool_create(&own_pool, slice_count) < 0) {
+		slice_count = 1;
+	}
+
+	size_t groups_per_slice = groups / slice_count;
+	size_t input_pos = 0;
+	size_t output_pos = 0;
+
+	for (size_t idx = 0; idx < slice_count; idx++) {
+		struct rfc4648_slice *slice = &slices[idx];
+		int last = idx == slice_count - 1;
+
+		*slice = *template;
+		slice->input = (const uint8_t *)template->input + input_pos;
+		slice->output = (uint8_t *)template->output + output_pos;
+		slice->input_size = last ? template->input_size - input_pos
+					 : groups_per_slice * group_size;
+		slice->output_size = last ? template->output_size - output_pos
+					  : groups_per_slice * output_group_size;
+
+		input_pos += slice->input_size;
+		output_pos += slice->output_size;
+	}
+
+	cpal_pool_parallel_for(pool != NULL ? pool : own_pool, 0, slice_count, 1,
+			       rfc4648_slices_run, slices);
+	cpal_pool_destroy(own_pool);
+
+	for (size_t idx = 0; idx < slice_count; idx++) {
+		if (slices[idx].err < 0 && err == 0) {
+			err = slices[idx].err;
+		}
+	}
+
+	return err;
+}
+
+static int rfc4648_decode_parallel(
+    const char *input, const size_t input_size, uint8_t *output,
+    size_t *output_size, struct cpal_pool *pool, unsigned int threads,
+    size_t group_chars, size_t group_bytes,
+    int (*decode_into)(const char *, const size_t, uint8_t *, size_t *),
+    size_t (*decoded_len)(const char *, const size_t))
+{
+	if (input == NULL || output_size == NULL ||
+	    input_size % group_chars != 0) {
+		return -EINVAL;
+	}
+
+	size_t decoded_size = decoded_len(input, input_size);
+
+	if (decoded_size > *output_size) {
+		return -ENOSPC;
+	}
+
+	struct rfc4648_slice template = {decode_into, NULL,	    input,
+					 input_size,  output,	    decoded_size,
+					 0};
+	int err = rfc4648_run_slices(&template, pool, threads, group_chars,
+				     group_bytes);
+
+	if (err < 0) {
+		return err;
+	}
+
+	*output_size = decoded_size;
+	return 0;
+}
+
+static int rfc4648_encode_parallel(
+    const uint8_t *input, const size_t input_size, char *output,
+    size_t *output_size, struct cpal_pool *pool, unsigned int threads,
+    size_t group_chars, size_t group_bytes,
+    int (*encode_into)(const uint8_t *, const size_t, char *, size_t *),
+    size_t (*encoded_len)(const size_t))
+{
+	if (input == NULL || output_size == NULL) {
+		return -EINVAL;
+	}
+
+	size_t encoded_size = encoded_len(input_size);
+
+	if (encoded_size > *output_size) {
+		return -ENOSPC;
+	}
+
+	struct rfc4648_slice template = {NULL,	 encode_into,  input, input_size,
+					 output, encoded_size, 0};
+	int err = rfc4648_run_slices(&template, pool, threads, group_bytes,
+				     group_chars);
+
+	if (err < 0) {
+		return err;
+	}
+
+	*output_size = encoded_size;
+	return 0;
+}
+
+int cpal_base16_decode_pool(const char *input, const size_t input_size,
+			    uint8_t *output, size_t *output_size,
+			    struct cpal_pool *pool)
+{
+	return rfc4648_decode_parallel(input, input_size, output, output_size, pool,
+				       0, 2, 1, cpal_base16_decode_into,
+				       cpal_base16_decoded_len);
+}
+
+int cpal_base16_decode_parallel(const char *input, const size_t input_size,
+				uint8_t *output, size_t *output_size,
+				unsigned int threads)
+{
+	return rfc4648_decode_parallel(input, input_size, output, output_size, NULL,
+				       threads, 2, 1, cpal_base16_decode_into,
+				       cpal_base16_decoded_len);
+}
+
+int cpal_base16_encode_pool(const uint8_t *input, const size_t input_size,
+			    char *output, size_t *output_size,
+			    struct cpal_pool *pool)
+{
+	return rfc4648_encode_parallel(input, input_size, output, output_size, pool,
+				       0, 2, 1, cpal_base16_encode_into,
+				       cpal_base16_encoded_len);
+}
+
+int cpal_base16_encode_parallel(const uint8_t *input, const size_t input_size,
+				char *output, size_t *output_size,
+				unsigned int threads)
+{
+	return rfc4648_encode_parallel(input, input_size, output, output_size, NULL,
+				       threads, 2, 1, cpal_base16_encode_into,
+				       cpal_base16_encoded_len);
+}
+
+int cpal_base32_decode_pool(const char *input, const size_t input_size,
+			    uint8_t *output, size_t *output_size,
+			    struct cpal_pool *pool)
+{
+	return rfc4648_decode_parallel(input, input_size, output, output_size, pool,
+				       0, 8, 5, cpal_base32_decode_into,
+				       cpal_base32_decoded_len);
+}
+
+int cpal_base32_decode_parallel(const char *input, const size_t input_size,
+				uint8_t *output, size_t *output_size,
+				unsigned int threads)
+{
+	return rfc4648_decode_parallel(input, input_size, output, output_size, NULL,
+				       threads, 8, 5, cpal_base32_decode_into,
+				       cpal_base32_decoded_len);
+}
+
+int cpal_base32_encode_pool(const uint8_t *input, const size_t input_size,
+			    char *output, size_t *output_size,
+			    struct cpal_pool *pool)
+{
+	return rfc4648_encode_parallel(input, input_size, output, output_size, pool,
+				       0, 8, 5, cpal_base32_encode_into,
+				       cpal_base32_encoded_len);
+}
+
+int cpal_base32_encode_parallel(const uint8_t *input, const size_t input_size,
+				char *output, size_t *output_size,
+				unsigned int threads)
+{
+	return rfc4648_encode_parallel(input, input_size, output, output_size, NULL,
+				       threads, 8, 5, cpal_base32_encode_into,
+				       cpal_base32_encoded_len);
+}
+
+int cpal_base32hex_decode_pool(const char *input, const size_t input_size,
+			       uint8_t *output, size_t *output_size,
+			       struct cpal_pool *pool)
+{
+	return rfc4648_decode_parallel(input, input_size, output, output_size, pool,
+				       0, 8, 5, cpal_base32hex_decode_into,
+				       cpal_base32hex_decoded_len);
+}
+
+int cpal_base32hex_decode_parallel(const char *input, const size_t input_size,
+				   uint8_t *output, size_t *output_size,
+				   unsigned int threads)
+{
+	return rfc4648_decode_parallel(input, input_size, output, output_size, NULL,
+				       threads, 8, 5, cpal_base32hex_decode_into,
+				       cpal_base32hex_decoded_len);
+}
+
+int cpal_base32hex_encode_pool(const uint8_t *input, const size_t input_size,
+			       char *output, size_t *output_size,
+			       struct cpal_pool *pool)
+{
+	return rfc4648_encode_parallel(input, input_size, output, output_size, pool,
+				       0, 8, 5, cpal_base32hex_encode_into,
+				       cpal_base32hex_encoded_len);
+}
+
+int cpal_base32hex_encode_parallel(const uint8_t *input, const size_t input_size,
+				   char *output, size_t *output_size,
+				   unsigned int threads)
+{
+	return rfc4648_encode_parallel(input, input_size, output, output_size, NULL,
+				       threads, 8, 5, cpal_base32hex_encode_into,
+				       cpal_base32hex_encoded_len);
+}
+
+int cpal_base64_decode_pool(const char *input, const size_t input_size,
+			    uint8_t *output, size_t *output_size,
+			    struct cpal_pool *pool)
+{
+	return rfc4648_decode_parallel(input, input_size, output, output_size, pool,
+				       0, 4, 3, cpal_base64_decode_into,
+				       cpal_base64_decoded_len);
+}
+
+int cpal_base64_decode_parallel(const char *input, const size_t input_size,
+				uint8_t *output, size_t *output_size,
+				unsigned int threads)
+{
+	return rfc4648_decode_parallel(input, input_size, output, output_size, NULL,
+				       threads, 4, 3, cpal_base64_decode_into,
+				       cpal_base64_decoded_len);
+}
+
+int cpal_base64_encode_pool(const uint8_t *input, const size_t input_size,
+			    char *output, size_t *output_size,
+			    struct cpal_pool *pool)
+{
+	return rfc4648_encode_parallel(input, input_size, output, output_size, pool,
+				       0, 4, 3, cpal_base64_encode_into,
+				       cpal_base64_encoded_len);
+}
+
+int cpal_base64_encode_parallel(const uint8_t *input, const size_t input_size,
+				char *output, size_t *output_size,
+				unsigned int threads)
+{
+	return rfc4648_encode_parallel(input, input_size, output, output_size, NULL,
+				       threads, 4, 3, cpal_base64_encode_into,
+				       cpal_base64_encoded_len);
+}
+
+int cpal_base64safe_decode_pool(const char *input, const size_t input_size,
+				uint8_t *output, size_t *output_size,
+				struct cpal_pool *pool)
+{
+	return rfc4648_decode_parallel(input, input_size, output, output_size, pool,
+				       0, 4, 3, cpal_base64safe_decode_into,
+				       cpal_base64safe_decoded_len);
+}
+
+int cpal_base64safe_decode_parallel(const char *input, const size_t input_size,
+				    uint8_t *output, size_t *output_size,
+				    unsigned int threads)
+{
+	return rfc4648_decode_parallel(input, input_size, output, output_size, NULL,
+				       threads, 4, 3, cpal_base64safe_decode_into,
+				       cpal_base64safe_decoded_len);
+}
+
+int cpal_base64safe_encode_pool(const uint8_t *input, const size_t input_size,
+				char *output, size_t *output_size,
+				struct cpal_pool *pool)
+{
+	return rfc4648_encode_parallel(input, input_size, output, output_size, pool,
+				       0, 4, 3, cpal_base64safe_encode_into,
+				       cpal_base64safe_encoded_len);
+}
+
+int cpal_base64safe_encode_parallel(const uint8_t *input, const size_t input_size,
+				    char *output, size_t *output_size,
+				    unsigned int threads)
+{
+	return rfc4648_encode_parallel(input, input_size, output, output_size, NULL,
+				       threads, 4, 3, cpal_base64safe_encode_into,
+				       cpal_base64safe_encoded_len);
+}
@@ -0,0 +1,316 @@
+/*
+ * Incremental RFC 4648 encoding and decoding.
+ *
+ * The contexts only ever buffer a single partial group, and hand every complete
+ * group straight to the one-shot _into functions so that streams are decoded by
+ * the same kernels as whole buffers.
+ */
+
+#include <cryptopal-common.h>
+
+#include <errno.h>
+#include <string.h>
+
+static void rfc4648_decoder_init(struct cpal_rfc4648_decoder *decoder,
+				 int (*decode_into)(const char *, const size_t,
+						    uint8_t *, size_t *),
+				 uint8_t input_group_bits, uint8_t output_group_bits)
+{
+	decoder->decode_into = decode_into;
+	decoder->group_chars = input_group_bits / output_group_bits;
+	decoder->group_bytes = input_group_bits / 8;
+	decoder->output_group_bits = output_group_bits;
+	decoder->finished = 0;
+	decoder->partial_len = 0;
+}
+
+static void rfc4648_encoder_init(struct cpal_rfc4648_encoder *encoder,
+				 int (*encode_into)(const uint8_t *, const size_t,
+						    char *, size_t *),
+				 uint8_t input_group_bits, uint8_t output_group_bits)
+{
+	encoder->encode_into = encode_into;
+	encoder->group_chars = input_group_bits / output_group_bits;
+	encoder->group_bytes = input_group_bits / 8;
+	encoder->partial_len = 0;
+}
+
+void cpal_base16_decoder_init(struct cpal_rfc4648_decoder *decoder)
+{
+	rfc4648_decoder_init(decoder, cpal_base16_decode_into, 8, 4);
+}
+
+void cpal_base32_decoder_init(struct cpal_rfc4648_decoder *decoder)
+{
+	rfc4648_decoder_init(decoder, cpal_base32_decode_into, 40, 5);
+}
+
+void cpal_base32hex_decoder_init(struct cpal_rfc4648_decoder *decoder)
+{
+	rfc4648_decoder_init(decoder, cpal_base32hex_decode_into, 40, 5);
+}
+
+void cpal_base64_decoder_init(struct cpal_rfc4648_decoder *decoder)
+{
+	rfc4648_decoder_init(decoder, cpal_base64_decode_into, 24, 6);
+}
+
+void cpal_base64safe_decoder_init(struct cpal_rfc4648_decoder *decoder)
+{
+	rfc4648_decoder_init(decoder, cpal_base64safe_decode_into, 24, 6);
+}
+
+void cpal_base16_encoder_init(struct cpal_rfc4648_encoder *encoder)
+{
+	rfc4648_encoder_init(encoder, cpal_base16_encode_into, 8, 4);
+}
+
+void cpal_base32_encoder_init(struct cpal_rfc4648_encoder *encoder)
+{
+	rfc4648_encoder_init(encoder, cpal_base32_encode_into, 40, 5);
+}
+
+void cpal_base32hex_encoder_init(struct cpal_rfc4648_encoder *encoder)
+{
+	rfc4648_encoder_init(encoder, cpal_base32hex_encode_into, 40, 5);
+}
+
+void cpal_base64_encoder_init(struct cpal_rfc4648_encoder *encoder)
+{
+	rfc4648_encoder_init(encoder, cpal_base64_encode_into, 24, 6);
+}
+
+void cpal_base64safe_encoder_init(struct cpal_rfc4648_encoder *encoder)
+{
+	rfc4648_encoder_init(encoder, cpal_base64safe_encode_into, 24, 6);
+}
+
+/**
+ * Decode @input_size characters of whole groups, and remember if the final group
+ * was padded since nothing may follow it.
+ */
+static int rfc4648_decoder_groups(struct cpal_rfc4648_decoder *decoder,
+				  const char *input, const size_t input_size,
+				  uint8_t *output, size_t *output_size)
+{
+	if (decoder->finished) {
+		return -EINVAL;
+	}
+
+	int err = decoder->decode_into(input, input_size, output, output_size);
+
+	if (err < 0) {
+		return err;
+	}
+
+	decoder->finished = input[input_size - 1] == '=';
+	return 0;
+}
+
+size_t cpal_rfc4648_decoder_max_output(const struct cpal_rfc4648_decoder *decoder,
+				       const size_t input_size)
+{
+	return (decoder->partial_len + input_size) / decoder->group_chars *
+	       decoder->group_bytes;
+}
+
+int cpal_rfc4648_decoder_update(struct cpal_rfc4648_decoder *decoder,
+				const char *input, const size_t input_size,
+				uint8_t *output, size_t *output_size)
+{
+	size_t input_pos = 0;
+	size_t output_pos = 0;
+	size_t written;
+	int err;
+
+	if (input == NULL || output_size == NULL) {
+		return -EINVAL;
+	}
+
+	if (cpal_rfc4648_decoder_max_output(decoder, input_size) > *output_size) {
+		return -ENOSPC;
+	}
+
+	// Complete the group carried over from the previous chunk first
+	if (decoder->partial_len > 0) {
+		size_t missing = decoder->group_chars - decoder->partial_len;
+		size_t copied = input_size < missing ? input_size : missing;
+
+		memcpy(decoder->partial + decoder->partial_len, input, copied);
+		decoder->partial_len += copied;
+		input_pos += copied;
+
+		if (decoder->partial_len < decoder->group_chars) {
+			*output_size = 0;
+			return 0;
+		}
+
+		written = *output_size;
+		err = rfc4648_decoder_groups(decoder, decoder->partial,
+					     decoder->group_chars, output, &written);
+
+		if (err < 0) {
+			return err;
+		}
+
+		decoder->partial_len = 0;
+		output_pos += written;
+	}
+
+	size_t remaining = input_size - input_pos;
+	size_t whole = remaining - remaining % decoder->group_chars;
+
+	if (whole > 0) {
+		written = *output_size - output_pos;
+		err = rfc4648_decoder_groups(decoder, input + input_pos, whole,
+					     output + output_pos, &written);
+
+		if (err < 0) {
+			return err;
+		}
+
+		input_pos += whole;
+		output_pos += written;
+	}
+
+	if (input_pos < input_size && decoder->finished) {
+		return -EINVAL;
+	}
+
+	memcpy(decoder->partial, input + input_pos, input_size - input_pos);
+	decoder->partial_len = input_size - input_pos;
+
+	*output_size = output_pos;
+	return 0;
+}
+
+int cpal_rfc4648_decoder_finalize(struct cpal_rfc4648_decoder *decoder,
+				  uint8_t *output, size_t *output_size)
+{
+	size_t data_chars = decoder->partial_len;
+
+	if (output_size == NULL) {
+		return -EINVAL;
+	}
+
+	if (decoder->partial_len == 0) {
+		*output_size = 0;
+		return 0;
+	}
+
+	while (data_chars > 0 && decoder->partial[data_chars - 1] == '=') {
+		data_chars--;
+	}
+
+	// The data characters must cover at least one byte, and leave fewer bits
+	// over than a single character holds
+	size_t data_bits = data_chars * decoder->output_group_bits;
+
+	if (data_bits < 8 || data_bits % 8 >= decoder->output_group_bits) {
+		return -EINVAL;
+	}
+
+	memset(decoder->partial + decoder->partial_len, '=',
+	       decoder->group_chars - decoder->partial_len);
+
+	int err = rfc4648_decoder_groups(decoder, decoder->partial,
+					 decoder->group_chars, output, output_size);
+
+	if (err < 0) {
+		return err;
+	}
+
+	decoder->partial_len = 0;
+	return 0;
+}
+
+size_t cpal_rfc4648_encoder_max_output(const struct cpal_rfc4648_encoder *encoder,
+				       const size_t input_size)
+{
+	return (encoder->partial_len + input_size) / encoder->group_bytes *
+	       encoder->group_chars;
+}
+
+int cpal_rfc4648_encoder_update(struct cpal_rfc4648_encoder *encoder,
+				const uint8_t *input, const size_t input_size,
+				char *output, size_t *output_size)
+{
+	size_t input_pos = 0;
+	size_t output_pos = 0;
+	size_t written;
+	int err;
+
+	if (input == NULL || output_size == NULL) {
+		return -EINVAL;
+	}
+
+	if (cpal_rfc4648_encoder_max_output(encoder, input_size) > *output_size) {
+		return -ENOSPC;
+	}
+
+	// Complete the group carried over from the previous chunk first
+	if (encoder->partial_len > 0) {
+		size_t missing = encoder->group_bytes - encoder->partial_len;
+		size_t copied = input_size < missing ? input_size : missing;
+
+		memcpy(encoder->partial + encoder->partial_len, input, copied);
+		encoder->partial_len += copied;
+		input_pos += copied;
+
+		if (encoder->partial_len < encoder->group_bytes) {
+			*output_size = 0;
+			return 0;
+		}
+
+		written = *output_size;
+		err = encoder->encode_into(encoder->partial, encoder->group_bytes,
+					   output, &written);
+
+		if (err < 0) {
+			return err;
+		}
+
+		encoder->partial_len = 0;
+		output_pos += written;
+	}
+
+	size_t remaining = input_size - input_pos;
+	size_t whole = remaining - remaining % encoder->group_bytes;
+
+	if (whole > 0) {
+		written = *output_size - output_pos;
+		err = encoder->encode_into(input + input_pos, whole,
+					   output + output_pos, &written);
+
+		if (err < 0) {
+			return err;
+		}
+
+		input_pos += whole;
+		output_pos += written;
+	}
+
+	memcpy(encoder->partial, input + input_pos, input_size - input_pos);
+	encoder->partial_len = input_size - input_pos;
+
+	*output_size = output_pos;
+	return 0;
+}
+
+int cpal_rfc4648_encoder_finalize(struct cpal_rfc4648_encoder *encoder,
+				  char *output, size_t *output_size)
+{
+	if (output_size == NULL) {
+		return -EINVAL;
+	}
+
+	int err = encoder->encode_into(encoder->partial, encoder->partial_len,
+				       output, output_size);
+
+	if (err < 0) {
+		return err;
+	}
+
+	encoder->partial_len = 0;
+	return 0;
+}
@@ -0,0 +1,254 @@
+/*
+ * Line-wrapped base64, as found in MIME bodies and PEM files.
+ *
+ * Both directions work in a single pass without copying the input anywhere:
+ *
+ * - Decoding scans for whitespace a vector at a time and feeds each run of text
+ *   between it straight from the input to a streaming decoder, which carries any
+ *   partial group over to the next run.  The whitespace isn't skipped inside the
+ *   decoding kernels themselves, which keeps them free of a per-vector compaction
+ *   step.
+ * - Encoding encodes each line straight into its place in the output and follows
+ *   it with a line break.  Every line but the last is a whole number of groups,
+ *   so no line has any padding.
+ */
+
+#include <cryptopal-common.h>
+
+#include <emmintrin.h>
+#include <errno.h>
+#include <stdlib.h>
+
+/**
+ * base64 encodes every 3 bytes of input as 4 characters.
+ */
+#define BASE64_GROUP_CHARS 4
+#define BASE64_GROUP_BYTES 3
+
+static int rfc4648_is_whitespace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' ||
+	       c == '\r';
+}
+
+/**
+ * Find the length of the run of characters at the start of @input that can't be
+ * whitespace.  Whitespace is all at or below ' ', so this stops at the first
+ * such character, leaving the caller to check what it actually is.
+ */
+static size_t rfc4648_text_span(const char *input, const size_t input_size)
+{
+	const __m128i space = _mm_set1_epi8(' ');
+	size_t pos = 0;
+
+	while (input_size - pos >= 16) {
+		__m128i in = _mm_loadu_si128((const __m128i *)(input + pos));
+		int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(in, space), in));
+
+		if (mask != 0) {
+			return pos + __builtin_ctz(mask);
+		}
+
+		pos += 16;
+	}
+
+	while (pos < input_size && (uint8_t)input[pos] > ' ') {
+		pos++;
+	}
+
+	return pos;
+}
+
+/**
+ * Decode the @span_len characters of whitespace-free text at @span, appending
+ * the bytes to @output.
+ */
+static int rfc4648_decode_span(struct cpal_rfc4648_decoder *decoder,
+			       const char *span, size_t span_len, uint8_t *output,
+			       size_t output_capacity, size_t *output_pos)
+{
+	size_t written = output_capacity - *output_pos;
+	int err = cpal_rfc4648_decoder_update(decoder, span, span_len,
+					      output + *output_pos, &written);
+
+	if (err < 0) {
+		return err;
+	}
+
+	*output_pos += written;
+	return 0;
+}
+
+static int rfc4648_decode_wrapped_into(const char *input, const size_t input_size,
+				       uint8_t *output, size_t *output_size,
+				       void (*decoder_init)(struct cpal_rfc4648_decoder *))
+{
+	struct cpal_rfc4648_decoder decoder;
+	size_t input_pos = 0;
+	size_t output_pos = 0;
+	int err;
+
+	if (input == NULL || output == NULL || output_size == NULL) {
+		return -EINVAL;
+	}
+
+	decoder_init(&decoder);
+
+	while (input_pos < input_size) {
+		size_t span = rfc4648_text_span(input + input_pos,
+						input_size - input_pos);
+
+		if (span > 0) {
+			err = rfc4648_decode_span(&decoder, input + input_pos,
+						  span, output, *output_size,
+						  &output_pos);
+			if (err < 0) {
+				return err;
+			}
+
+			input_pos += span;
+		}
+
+		if (input_pos < input_size) {
+			if (!rfc4648_is_whitespace(input[input_pos])) {
+				return -EINVAL;
+			}
+
+			input_pos++;
+		}
+	}
+
+	size_t written = *output_size - output_pos;
+
+	err = cpal_rfc4648_decoder_finalize(&decoder, output + output_pos, &written);
+	if (err < 0) {
+		return err;
+	}
+
+	*output_size = output_pos + written;
+	return 0;
+}
+
+size_t cpal_base64_decoded_wrapped_len(const size_t input_size)
+{
+	return input_size / BASE64_GROUP_CHARS * BASE64_GROUP_BYTES + 2;
+}
+
+int cpal_base64_decode_wrapped(const char *input, const size_t input_size,
+			       uint8_t **output, size_t *output_size)
+{
+	size_t output_capacity = cpal_base64_decoded_wrapped_len(input_size);
+	uint8_t *output_tmp = calloc(sizeof *output_tmp, output_capacity);
+
+	if (output_tmp == NULL) {
+		return -ENOMEM;
+	}
+
+	int err = rfc4648_decode_wrapped_into(input, input_size, output_tmp,
+					      &output_capacity,
+					      cpal_base64_decoder_init);
+
+	if (err < 0) {
+		free(output_tmp);
+		return err;
+	}
+
+	*output = output_tmp;
+	*output_size = output_capacity;
+	return 0;
+}
+
+int cpal_base64_decode_wrapped_into(const char *input, const size_t input_size,
+				    uint8_t *output, size_t *output_size)
+{
+	return rfc4648_decode_wrapped_into(input, input_size, output, output_size,
+					   cpal_base64_decoder_init);
+}
+
+size_t cpal_base64_encoded_wrapped_len(const size_t input_size,
+				       const size_t line_len)
+{
+	size_t encoded_size = cpal_base64_encoded_len(input_size);
+
+	if (encoded_size == 0 || line_len == 0) {
+		return encoded_size;
+	}
+
+	return encoded_size + (encoded_size - 1) / line_len;
+}
+
+int cpal_base64_encode_wrapped_into(const uint8_t *input, const size_t input_size,
+				    const size_t line_len, char *output,
+				    size_t *output_size)
+{
+	if (input == NULL || output_size == NULL ||
+	    line_len % BASE64_GROUP_CHARS != 0) {
+		return -EINVAL;
+	}
+
+	size_t encoded_size = cpal_base64_encoded_wrapped_len(input_size, line_len);
+
+	if (encoded_size > *output_size) {
+		return -ENOSPC;
+	}
+
+	// A line length of 0 means a single unbroken line
+	if (line_len == 0) {
+		return cpal_base64_encode_into(input, input_size, output, output_size);
+	}
+
+	size_t line_bytes = line_len / BASE64_GROUP_CHARS * BASE64_GROUP_BYTES;
+	size_t input_pos = 0;
+	size_t output_pos = 0;
+
+	while (input_pos < input_size) {
+		size_t chunk = input_size - input_pos;
+
+		if (chunk > line_bytes) {
+			chunk = line_bytes;
+		}
+
+		size_t written = encoded_size - output_pos;
+		int err = cpal_base64_encode_into(input + input_pos, chunk,
+						  output + output_pos, &written);
+
+		if (err < 0) {
+			return err;
+		}
+
+		input_pos += chunk;
+		output_pos += written;
+
+		// The final line of the output has no line break
+		if (input_pos < input_size) {
+			output[output_pos++] = '\n';
+		}
+	}
+
+	*output_size = encoded_size;
+	return 0;
+}
+
+int cpal_base64_encode_wrapped(const uint8_t *input, const size_t input_size,
+			       const size_t line_len, char **output,
+			       size_t *output_size)
+{
+	size_t encoded_size = cpal_base64_encoded_wrapped_len(input_size, line_len);
+	char *output_tmp = calloc(sizeof *output_tmp, encoded_size + 1);
+
+	if (output_tmp == NULL) {
+		return -ENOMEM;
+	}
+
+	int err = cpal_base64_encode_wrapped_into(input, input_size, line_len,
+						  output_tmp, &encoded_size);
+
+	if (err < 0) {
+		free(output_tmp);
+		return err;
+	}
+
+	*output = output_tmp;
+	*output_size = encoded_size + 1;
+	return 0;
+}
@@ -1,4 +1,4 @@
-#include <cryptopal-common.h>
+#include "utils_analysis_internal.h"
 
 #include <errno.h>
 #include <math.h>
@@ -45,28 +45,1008 @@ error:
 	return ret;
 }
 
-double cpal_analysis_bhattacharyya_score(const double table[256],
-					 const uint8_t *decrypted, const size_t len)
+int cpal_analysis_try_key_arena(const uint8_t *ciphertext, const size_t len,
+				const uint8_t *key, const size_t key_len,
+				struct cpal_analysis_key_score *score,
+				cpal_analysis_score_fn score_fn,
+				cpal_analysis_decrypt_into_fn decrypt_fn,
+				struct cpal_arena *arena)
+{
+	uint8_t *key_cpy = cpal_arena_alloc(arena, key_len);
+	uint8_t *decrypted = cpal_arena_alloc(arena, len);
+	size_t decrypted_len = len;
+
+	if (key_cpy == NULL || decrypted == NULL) {
+		return -ENOMEM;
+	}
+
+	int ret = decrypt_fn(key, key_len, ciphertext, len, decrypted, &decrypted_len);
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	memcpy(key_cpy, key, key_len);
+
+	score->decrypted = decrypted;
+	score->decrypted_len = decrypted_len;
+	score->key = key_cpy;
+	score->key_len = key_len;
+	score->score = score_fn(decrypted, decrypted_len);
+
+	return 0;
+}
+
+void cpal_strided_view_init_column(struct cpal_strided_view *view,
+				   const uint8_t *data, const size_t len,
+				   const size_t columns, const size_t column)
+{
+	view->base = data + column;
+	view->stride = columns;
+	view->count = column < len ? (len - column + columns - 1) / columns : 0;
+}
+
+static void analysis_histogram(const uint8_t *data, const size_t len,
+			       const size_t stride, size_t histogram[256])
+{
+	// Consecutive equal bytes would otherwise wait on each other's increment,
+	// so alternate between four partial histograms and sum them at the end
+	uint32_t partial[4][256] = {{0}};
+	size_t pos = 0;
+
+	memset(histogram, 0, 256 * sizeof *histogram);
+
+	while (pos < len) {
+		size_t chunk = len - pos < UINT32_MAX ? len - pos : UINT32_MAX;
+		size_t end = pos + chunk;
+
+		for (; end - pos >= 4; pos += 4) {
+			partial[0][data[pos * stride]]++;
+			partial[1][data[(pos + 1) * stride]]++;
+			partial[2][data[(pos + 2) * stride]]++;
+			partial[3][data[(pos + 3) * stride]]++;
+		}
+
+		for (; pos < end; pos++) {
+			partial[0][data[pos * stride]]++;
+		}
+
+		for (unsigned int val = 0; val < 256; val++) {
+			histogram[val] += (size_t)partial[0][val] + partial[1][val] +
+					  partial[2][val] + partial[3][val];
+		}
+
+		memset(partial, 0, sizeof(partial));
+	}
+}
+
+void cpal_analysis_histogram(const uint8_t *data, const size_t len,
+			     size_t histogram[256])
+{
+	analysis_histogram(data, len, 1, histogram);
+}
+
+void cpal_analysis_histogram_strided(const struct cpal_strided_view *view,
+				     size_t histogram[256])
+{
+	analysis_histogram(view->base, view->count, view->stride, histogram);
+}
+
+void cpal_analysis_column_histograms(const uint8_t *data, const size_t len,
+				     const size_t columns,
+				     size_t (*histograms)[256])
+{
+	size_t pos = 0;
+
+	memset(histograms, 0, columns * sizeof *histograms);
+
+	// Walk the data a row at a time, so no byte needs its column worked out
+	for (; len - pos >= columns; pos += columns) {
+		for (size_t column = 0; column < columns; column++) {
+			histograms[column][data[pos + column]]++;
+		}
+	}
+
+	for (size_t column = 0; pos < len; pos++, column++) {
+		histograms[column][data[pos]]++;
+	}
+}
+
+void cpal_analysis_model_init_scorer(struct cpal_analysis_model *model,
+				     const double table[256],
+				     const enum cpal_analysis_scorer scorer)
+{
+	double total = 0.0;
+
+	model->scorer = scorer;
+
+	for (unsigned int val = 0; val < 256; val++) {
+		model->sqrt_probabilities[val] = sqrt(table[val]);
+		model->weights[val] = 0;
+		total += table[val];
+	}
+
+	model->total_probability = total;
+	model->max_weight = 0;
+
+	if (scorer == CPAL_ANALYSIS_BHATTACHARYYA || !(total > 0.0)) {
+		return;
+	}
+
+	for (unsigned int val = 0; val < 256; val++) {
+		double p = table[val] / total;
+
+		if (p < ANALYSIS_MIN_PROBABILITY) {
+			p = ANALYSIS_MIN_PROBABILITY;
+		}
+
+		if (scorer == CPAL_ANALYSIS_LOG_LIKELIHOOD) {
+			model->weights[val] =
+			    (int32_t)lround(log(p) * ANALYSIS_LOG_LIKELIHOOD_SCALE);
+		} else {
+			model->weights[val] =
+			    (int32_t)lround(ANALYSIS_CHI_SQUARED_SCALE / p);
+		}
+
+		if (val == 0 || model->weights[val] > model->max_weight) {
+			model->max_weight = model->weights[val];
+		}
+	}
+}
+
+void cpal_analysis_model_init(struct cpal_analysis_model *model,
+			      const double table[256])
+{
+	cpal_analysis_model_init_scorer(model, table, CPAL_ANALYSIS_BHATTACHARYYA);
+}
+
+/**
+ * Score a byte @histogram with the weights of @model, as a dense dot product
+ * over all 256 byte values.  There are no branches on the counts, so the loops
+ * vectorize.
+ */
+static double analysis_weighted_histogram(const struct cpal_analysis_model *model,
+					  const size_t histogram[256],
+					  const size_t len)
+{
+	if (model->scorer == CPAL_ANALYSIS_LOG_LIKELIHOOD) {
+		int64_t dot = 0;
+
+		for (unsigned int val = 0; val < 256; val++) {
+			dot += (int64_t)histogram[val] * model->weights[val];
+		}
+
+		return analysis_weighted_score(model, (double)dot, len);
+	}
+
+	if (len > ANALYSIS_CHI_SQUARED_MAX_EXACT_LEN) {
+		double dot = 0.0;
+
+		for (unsigned int val = 0; val < 256; val++) {
+			double count = (double)histogram[val];
+
+			dot += count * count * model->weights[val];
+		}
+
+		return analysis_weighted_score(model, dot, len);
+	}
+
+	uint64_t dot = 0;
+
+	for (unsigned int val = 0; val < 256; val++) {
+		uint64_t count = histogram[val];
+
+		dot += count * count * (uint64_t)model->weights[val];
+	}
+
+	return analysis_weighted_score(model, (double)dot, len);
+}
+
+double cpal_analysis_model_score_histogram(const struct cpal_analysis_model *model,
+					   const size_t histogram[256],
+					   const size_t len)
 {
 	double score = 0.0;
 
+	if (len == 0) {
+		return score;
+	}
+
+	if (model->scorer != CPAL_ANALYSIS_BHATTACHARYYA) {
+		return analysis_weighted_histogram(model, histogram, len);
+	}
+
+	// sqrt(p * q) == sqrt(p) * sqrt(count) / sqrt(len), and bytes which never
+	// occur add nothing
 	for (unsigned int val = 0; val < 256; val++) {
-		size_t occurrences = 0;
-		size_t pos = 0;
+		if (histogram[val] != 0) {
+			score += model->sqrt_probabilities[val] *
+				 sqrt((double)histogram[val]);
+		}
+	}
+
+	return score / sqrt((double)len);
+}
+
+static double analysis_model_score(const struct cpal_analysis_model *model,
+				   const uint8_t *decrypted, const size_t len,
+				   const size_t stride)
+{
+	size_t histogram[256];
+
+	if (len == 0) {
+		return 0.0;
+	}
+
+	analysis_histogram(decrypted, len, stride, histogram);
+	return cpal_analysis_model_score_histogram(model, histogram, len);
+}
+
+double cpal_analysis_model_score(const struct cpal_analysis_model *model,
+				 const uint8_t *decrypted, const size_t len)
+{
+	return analysis_model_score(model, decrypted, len, 1);
+}
+
+double cpal_analysis_model_score_strided(const struct cpal_analysis_model *model,
+					 const struct cpal_strided_view *view)
+{
+	return analysis_model_score(model, view->base, view->count, view->stride);
+}
+
+/**
+ * Whether entry @a ranks below entry @b: a lower score, or for equal scores a
+ * later candidate or key, so that ties always resolve the same way.
+ */
+static int analysis_top_worse(const struct cpal_analysis_top_entry *a,
+			      const struct cpal_analysis_top_entry *b)
+{
+	if (a->score < b->score) {
+		return 1;
+	} else if (a->score > b->score) {
+		return 0;
+	} else if (a->idx != b->idx) {
+		return a->idx > b->idx;
+	} else {
+		return a->key > b->key;
+	}
+}
+
+/**
+ * Restore the heap below @pos, where the worst entry kept is at the root.
+ */
+static void analysis_top_sift_down(struct cpal_analysis_top_entry *entries,
+				   size_t len, size_t pos)
+{
+	for (;;) {
+		size_t child = pos * 2 + 1;
 
-		while (pos < len) {
-			if (decrypted[pos++] == val) {
-				occurrences++;
+		if (child >= len) {
+			return;
+		}
+
+		if (child + 1 < len &&
+		    analysis_top_worse(&entries[child + 1], &entries[child])) {
+			child++;
+		}
+
+		if (!analysis_top_worse(&entries[child], &entries[pos])) {
+			return;
+		}
+
+		struct cpal_analysis_top_entry tmp = entries[pos];
+
+		entries[pos] = entries[child];
+		entries[child] = tmp;
+		pos = child;
+	}
+}
+
+void cpal_analysis_top_init(struct cpal_analysis_top *top,
+			    struct cpal_analysis_top_entry *entries,
+			    const size_t capacity)
+{
+	top->entries = entries;
+	top->capacity = capacity;
+	top->len = 0;
+}
+
+int cpal_analysis_top_offer(struct cpal_analysis_top *top, const double score,
+			    const uint64_t key, const size_t idx)
+{
+	struct cpal_analysis_top_entry entry = {score, key, idx};
+
+	if (top->len < top->capacity) {
+		size_t pos = top->len++;
+
+		// Sift the new entry up past any better entries
+		while (pos > 0) {
+			size_t parent = (pos - 1) / 2;
+
+			if (!analysis_top_worse(&entry, &top->entries[parent])) {
+				break;
 			}
+
+			top->entries[pos] = top->entries[parent];
+			pos = parent;
+		}
+
+		top->entries[pos] = entry;
+		return 1;
+	}
+
+	if (top->capacity == 0 || !analysis_top_worse(&top->entries[0], &entry)) {
+		return 0;
+	}
+
+	top->entries[0] = entry;
+	analysis_top_sift_down(top->entries, top->len, 0);
+	return 1;
+}
+
+double cpal_analysis_top_threshold(const struct cpal_analysis_top *top)
+{
+	if (top->len < top->capacity || top->capacity == 0) {
+		return -INFINITY;
+	}
+
+	return top->entries[0].score;
+}
+
+void cpal_analysis_top_sort(struct cpal_analysis_top *top)
+{
+	// Repeatedly move the worst remaining entry to the end
+	for (size_t len = top->len; len > 1; len--) {
+		struct cpal_analysis_top_entry worst = top->entries[0];
+
+		top->entries[0] = top->entries[len - 1];
+		top->entries[len - 1] = worst;
+		analysis_top_sift_down(top->entries, len - 1, 0);
+	}
+}
+
+/**
+ * The bytes occurring in a ciphertext, and the number of times each occurs and
+ * its square root, which is all single-byte XOR keys are scored from.
+ */
+struct analysis_byte_counts {
+	uint8_t present[256];
+	uint64_t counts[256];
+	double sqrt_counts[256];
+	size_t present_len;
+	size_t len;
+	double sqrt_len;
+};
+
+/**
+ * Gather the bytes counted in @histogram, out of @len bytes in total.
+ */
+static void analysis_counts_from_histogram(const size_t histogram[256],
+					   const size_t len,
+					   struct analysis_byte_counts *counts)
+{
+	counts->present_len = 0;
+	counts->len = len;
+	counts->sqrt_len = sqrt((double)len);
+
+	for (unsigned int val = 0; val < 256; val++) {
+		if (histogram[val] != 0) {
+			counts->present[counts->present_len] = val;
+			counts->counts[counts->present_len] = histogram[val];
+			counts->sqrt_counts[counts->present_len++] =
+			    sqrt((double)histogram[val]);
 		}
+	}
+}
+
+/**
+ * Count the @len bytes of @data which are @stride bytes apart, so that a column
+ * of a ciphertext can be counted where it is.
+ */
+static void analysis_count_bytes(const uint8_t *data, const size_t len,
+				 const size_t stride,
+				 struct analysis_byte_counts *counts)
+{
+	if (len > UINT32_MAX) {
+		size_t histogram[256];
+
+		analysis_histogram(data, len, stride, histogram);
+		analysis_counts_from_histogram(histogram, len, counts);
+		return;
+	}
+
+	uint32_t occurrences[256] = {0};
 
-		double probability = (double)occurrences / (double)len;
-		double expected_probability = table[val];
+	counts->present_len = 0;
+	counts->len = len;
+	counts->sqrt_len = sqrt((double)len);
 
-		score += sqrt(expected_probability * probability);
+	for (size_t pos = 0; pos < len; pos++) {
+		occurrences[data[pos * stride]]++;
 	}
 
-	return score;
+	// Short lines only hold a handful of distinct bytes, so find them by
+	// walking the line again rather than scanning all 256 counts
+	for (size_t pos = 0; pos < len; pos++) {
+		uint8_t val = data[pos * stride];
+
+		if (occurrences[val] != 0) {
+			counts->present[counts->present_len] = val;
+			counts->counts[counts->present_len] = occurrences[val];
+			counts->sqrt_counts[counts->present_len++] =
+			    sqrt(occurrences[val]);
+			occurrences[val] = 0;
+		}
+	}
+}
+
+/**
+ * Score the plaintext that decrypting with @key would give with the weights of
+ * @model, from the ciphertext bytes in @counts.
+ */
+static double analysis_weighted_key(const struct cpal_analysis_model *model,
+				    const struct analysis_byte_counts *counts,
+				    const unsigned int key)
+{
+	if (model->scorer == CPAL_ANALYSIS_LOG_LIKELIHOOD) {
+		int64_t dot = 0;
+
+		for (size_t pos = 0; pos < counts->present_len; pos++) {
+			dot += (int64_t)counts->counts[pos] *
+			       model->weights[counts->present[pos] ^ key];
+		}
+
+		return analysis_weighted_score(model, (double)dot, counts->len);
+	}
+
+	if (counts->len > ANALYSIS_CHI_SQUARED_MAX_EXACT_LEN) {
+		double dot = 0.0;
+
+		for (size_t pos = 0; pos < counts->present_len; pos++) {
+			double count = (double)counts->counts[pos];
+
+			dot += count * count *
+			       model->weights[counts->present[pos] ^ key];
+		}
+
+		return analysis_weighted_score(model, dot, counts->len);
+	}
+
+	uint64_t dot = 0;
+
+	for (size_t pos = 0; pos < counts->present_len; pos++) {
+		uint64_t count = counts->counts[pos];
+
+		dot += count * count *
+		       (uint64_t)model->weights[counts->present[pos] ^ key];
+	}
+
+	return analysis_weighted_score(model, (double)dot, counts->len);
+}
+
+/**
+ * Score the plaintext that decrypting with @key would give.  Decrypting moves
+ * every count of ciphertext byte c to plaintext byte c ^ key, so nothing needs to
+ * be decrypted.
+ */
+static double analysis_score_key(const struct cpal_analysis_model *model,
+				 const struct analysis_byte_counts *counts,
+				 const unsigned int key)
+{
+	double score = 0.0;
+
+	if (counts->present_len == 0) {
+		return score;
+	}
+
+	if (model->scorer != CPAL_ANALYSIS_BHATTACHARYYA) {
+		return analysis_weighted_key(model, counts, key);
+	}
+
+	for (size_t pos = 0; pos < counts->present_len; pos++) {
+		score += model->sqrt_probabilities[counts->present[pos] ^ key] *
+			 counts->sqrt_counts[pos];
+	}
+
+	return score / counts->sqrt_len;
+}
+
+static void analysis_rank_counts(const struct cpal_analysis_model *model,
+				 const struct analysis_byte_counts *counts,
+				 const size_t idx, struct cpal_analysis_top *top)
+{
+	for (unsigned int key = 0; key < 256; key++) {
+		cpal_analysis_top_offer(top, analysis_score_key(model, counts, key),
+					key, idx);
+	}
+}
+
+void cpal_analysis_rank_single_byte_xor(const struct cpal_analysis_model *model,
+					const uint8_t *ciphertext, const size_t len,
+					const size_t idx, struct cpal_analysis_top *top)
+{
+	struct analysis_byte_counts counts;
+
+	analysis_count_bytes(ciphertext, len, 1, &counts);
+	analysis_rank_counts(model, &counts, idx, top);
+}
+
+void cpal_analysis_rank_single_byte_xor_strided(
+    const struct cpal_analysis_model *model, const struct cpal_strided_view *view,
+    const size_t idx, struct cpal_analysis_top *top)
+{
+	struct analysis_byte_counts counts;
+
+	analysis_count_bytes(view->base, view->count, view->stride, &counts);
+	analysis_rank_counts(model, &counts, idx, top);
+}
+
+void cpal_analysis_batch_init(struct cpal_analysis_batch *batch, double *scores,
+			      uint8_t *keys, size_t *lines, const size_t capacity)
+{
+	batch->scores = scores;
+	batch->keys = keys;
+	batch->lines = lines;
+	batch->capacity = capacity;
+	batch->len = 0;
+}
+
+/**
+ * Find the single-byte key scoring best for the ciphertext bytes in @counts, and
+ * store its score in @score.  Ties go to the lowest key, as they do in
+ * @cpal_analysis_rank_single_byte_xor.
+ */
+static uint8_t analysis_best_key(const struct cpal_analysis_model *model,
+				 const struct analysis_byte_counts *counts,
+				 double *score)
+{
+	unsigned int best_key = 0;
+
+	*score = -INFINITY;
+
+	for (unsigned int key = 0; key < 256; key++) {
+		double key_score = analysis_score_key(model, counts, key);
+
+		if (key_score > *score) {
+			*score = key_score;
+			best_key = key;
+		}
+	}
+
+	return best_key;
+}
+
+/**
+ * Store the best key of @line in its entry of @batch.
+ */
+static void analysis_batch_line(const struct cpal_analysis_model *model,
+				const uint8_t *ciphertext, const size_t len,
+				const size_t line, struct cpal_analysis_batch *batch)
+{
+	struct analysis_byte_counts counts;
+	double score;
+
+	analysis_count_bytes(ciphertext, len, 1, &counts);
+
+	batch->keys[line] = analysis_best_key(model, &counts, &score);
+	batch->scores[line] = score;
+	batch->lines[line] = line;
+}
+
+/**
+ * The number of lines scored at once by a thread.  Lines are scored
+ * independently, so this only needs to be large enough to amortize handing the
+ * range over.
+ */
+#define ANALYSIS_BATCH_GRAIN 256
+
+/**
+ * A corpus being scored, either packed with @offsets or as separate @lines.
+ */
+struct analysis_batch_job {
+	const struct cpal_analysis_model *model;
+	const uint8_t *corpus;
+	const size_t *offsets;
+	const uint8_t *const *lines;
+	const size_t *lens;
+	struct cpal_analysis_batch *batch;
+};
+
+static void analysis_batch_run(void *arg, size_t begin, size_t end)
+{
+	const struct analysis_batch_job *job = arg;
+
+	for (size_t line = begin; line < end; line++) {
+		if (job->corpus != NULL) {
+			analysis_batch_line(job->model, job->corpus + job->offsets[line],
+					    job->offsets[line + 1] - job->offsets[line],
+					    line, job->batch);
+		} else {
+			analysis_batch_line(job->model, job->lines[line],
+					    job->lens[line], line, job->batch);
+		}
+	}
+}
+
+int cpal_analysis_batch_single_byte_xor(const struct cpal_analysis_model *model,
+					const uint8_t *corpus, const size_t *offsets,
+					const size_t count,
+					struct cpal_analysis_batch *batch,
+					struct cpal_pool *pool)
+{
+	struct analysis_batch_job job = {model, corpus, offsets, NULL, NULL, batch};
+
+	if (corpus == NULL || offsets == NULL || count > batch->capacity) {
+		return -EINVAL;
+	}
+
+	cpal_pool_parallel_for(pool, 0, count, ANALYSIS_BATCH_GRAIN,
+			       analysis_batch_run, &job);
+	batch->len = count;
+	return 0;
+}
+
+int cpal_analysis_batch_single_byte_xor_vec(const struct cpal_analysis_model *model,
+					    const uint8_t *const *lines,
+					    const size_t *lens, const size_t count,
+					    struct cpal_analysis_batch *batch,
+					    struct cpal_pool *pool)
+{
+	struct analysis_batch_job job = {model, NULL, NULL, lines, lens, batch};
+
+	if (lines == NULL || lens == NULL || count > batch->capacity) {
+		return -EINVAL;
+	}
+
+	cpal_pool_parallel_for(pool, 0, count, ANALYSIS_BATCH_GRAIN,
+			       analysis_batch_run, &job);
+	batch->len = count;
+	return 0;
+}
+
+/**
+ * Whether entry @a of @batch ranks below entry @b: a lower score, or for equal
+ * scores a later line.
+ */
+static int analysis_batch_worse(const struct cpal_analysis_batch *batch,
+				const size_t a, const size_t b)
+{
+	if (batch->scores[a] < batch->scores[b]) {
+		return 1;
+	} else if (batch->scores[a] > batch->scores[b]) {
+		return 0;
+	} else {
+		return batch->lines[a] > batch->lines[b];
+	}
+}
+
+static void analysis_batch_swap(struct cpal_analysis_batch *batch, const size_t a,
+				const size_t b)
+{
+	double score = batch->scores[a];
+	uint8_t key = batch->keys[a];
+	size_t line = batch->lines[a];
+
+	batch->scores[a] = batch->scores[b];
+	batch->keys[a] = batch->keys[b];
+	batch->lines[a] = batch->lines[b];
+	batch->scores[b] = score;
+	batch->keys[b] = key;
+	batch->lines[b] = line;
+}
+
+/**
+ * Restore the heap of the first @len entries of @batch below @pos, where the
+ * worst entry is at the root.
+ */
+static void analysis_batch_sift_down(struct cpal_analysis_batch *batch,
+				     size_t len, size_t pos)
+{
+	for (;;) {
+		size_t child = pos * 2 + 1;
+
+		if (child >= len) {
+			return;
+		}
+
+		if (child + 1 < len && analysis_batch_worse(batch, child + 1, child)) {
+			child++;
+		}
+
+		if (!analysis_batch_worse(batch, child, pos)) {
+			return;
+		}
+
+		analysis_batch_swap(batch, pos, child);
+		pos = child;
+	}
+}
+
+void cpal_analysis_batch_sort(struct cpal_analysis_batch *batch)
+{
+	// Heapify with the worst entry at the root, then repeatedly move the
+	// worst remaining entry to the end
+	for (size_t pos = batch->len / 2; pos-- > 0;) {
+		analysis_batch_sift_down(batch, batch->len, pos);
+	}
+
+	for (size_t len = batch->len; len > 1; len--) {
+		analysis_batch_swap(batch, 0, len - 1);
+		analysis_batch_sift_down(batch, len - 1, 0);
+	}
+}
+
+int cpal_analysis_best_single_byte_xor(const struct cpal_analysis_model *model,
+				       const uint8_t *ciphertext, const size_t len,
+				       struct cpal_analysis_key_score *scores,
+				       const size_t count)
+{
+	struct cpal_analysis_top_entry entries[256];
+	struct cpal_analysis_top top;
+	size_t materialized = 0;
+	int ret;
+
+	if (ciphertext == NULL || (scores == NULL && count > 0)) {
+		return -EINVAL;
+	}
+
+	cpal_analysis_top_init(&top, entries, count < 256 ? count : 256);
+	cpal_analysis_rank_single_byte_xor(model, ciphertext, len, 0, &top);
+	cpal_analysis_top_sort(&top);
+
+	// Only the winners are ever decrypted
+	for (; materialized < top.len; materialized++) {
+		struct cpal_analysis_key_score *score = &scores[materialized];
+
+		score->key = NULL;
+		score->decrypted = NULL;
+
+		ret = cpal_cipher_xor_bytewise(ciphertext, len,
+					       entries[materialized].key,
+					       &score->decrypted);
+		if (ret < 0) {
+			goto error;
+		}
+
+		score->key = malloc(1);
+		if (score->key == NULL) {
+			ret = -ENOMEM;
+			free(score->decrypted);
+			goto error;
+		}
+
+		score->key[0] = entries[materialized].key;
+		score->key_len = 1;
+		score->decrypted_len = len;
+		score->score = entries[materialized].score;
+	}
+
+	return (int)materialized;
+error:
+	while (materialized-- > 0) {
+		free(scores[materialized].key);
+		free(scores[materialized].decrypted);
+	}
+
+	return ret;
+}
+
+/**
+ * The number of key sizes solved in full when breaking repeating-key XOR.  The
+ * multiples of the key size are about as close as the key size itself, so a few
+ * more than asked for are solved and ranked on the plaintexts they give.
+ */
+#define ANALYSIS_REPEATING_MIN_CANDIDATES 4
+#define ANALYSIS_REPEATING_MAX_CANDIDATES 64
+
+/**
+ * Find the shortest period of @key, of at least @min_key_len bytes, which it is
+ * a repetition of.  Multiples of the key size often look at least as likely as
+ * the size itself, and solve to the key repeated.
+ */
+static size_t analysis_key_period(const uint8_t *key, const size_t key_len,
+				  const size_t min_key_len)
+{
+	for (size_t period = min_key_len; period < key_len; period++) {
+		if (key_len % period == 0 &&
+		    memcmp(key, key + period, key_len - period) == 0) {
+			return period;
+		}
+	}
+
+	return key_len;
+}
+
+/**
+ * A repeating-key XOR ciphertext having each column of its key solved.
+ */
+struct analysis_column_job {
+	const struct cpal_analysis_model *model;
+	const size_t (*histograms)[256];
+	size_t len;
+	size_t key_len;
+	uint8_t *key;
+};
+
+static void analysis_solve_columns(void *arg, size_t begin, size_t end)
+{
+	const struct analysis_column_job *job = arg;
+	struct analysis_byte_counts counts;
+	double score;
+
+	for (size_t column = begin; column < end; column++) {
+		size_t column_len = (job->len - column + job->key_len - 1) /
+				    job->key_len;
+
+		analysis_counts_from_histogram(job->histograms[column], column_len,
+					       &counts);
+		job->key[column] = analysis_best_key(job->model, &counts, &score);
+	}
+}
+
+int cpal_analysis_break_repeating_xor(const struct cpal_analysis_model *model,
+				      const uint8_t *ciphertext, const size_t len,
+				      const size_t min_key_len,
+				      const size_t max_key_len,
+				      struct cpal_analysis_key_score *scores,
+				      const size_t count, struct cpal_pool *pool)
+{
+	struct cpal_analysis_top_entry size_entries[ANALYSIS_REPEATING_MAX_CANDIDATES];
+	struct cpal_analysis_top_entry key_entries[ANALYSIS_REPEATING_MAX_CANDIDATES];
+	uint8_t *keys[ANALYSIS_REPEATING_MAX_CANDIDATES] = {NULL};
+	size_t key_lens[ANALYSIS_REPEATING_MAX_CANDIDATES];
+	struct cpal_analysis_top sizes;
+	struct cpal_analysis_top ranked;
+	size_t (*histograms)[256] = NULL;
+	size_t histograms_len = 0;
+	size_t candidates = count;
+	size_t materialized = 0;
+	int ret = 0;
+
+	if (ciphertext == NULL || (scores == NULL && count > 0) || min_key_len == 0 ||
+	    min_key_len > max_key_len) {
+		return -EINVAL;
+	}
+
+	if (candidates < ANALYSIS_REPEATING_MIN_CANDIDATES) {
+		candidates = ANALYSIS_REPEATING_MIN_CANDIDATES;
+	}
+
+	if (candidates > ANALYSIS_REPEATING_MAX_CANDIDATES) {
+		candidates = ANALYSIS_REPEATING_MAX_CANDIDATES;
+	}
+
+	// Comparing the ciphertext against itself shifted by the key size
+	// compares every pair of consecutive blocks at once.  Bytes encrypted
+	// with the same key byte differ exactly as much as their plaintexts do,
+	// so the right key size gives the fewest differing bits per byte.  The
+	// key size is the candidate offered, so equal distances go to the
+	// shorter size
+	cpal_analysis_top_init(&sizes, size_entries, candidates);
+
+	for (size_t key_len = min_key_len; key_len <= max_key_len && key_len <= len / 2;
+	     key_len++) {
+		uint64_t distance = cpal_hamming_distance(
+		    ciphertext, ciphertext + key_len, len - key_len);
+
+		cpal_analysis_top_offer(&sizes, -(double)distance / (len - key_len),
+					key_len, 0);
+	}
+
+	cpal_analysis_top_sort(&sizes);
+
+	if (sizes.len == 0) {
+		return 0;
+	}
+
+	for (size_t candidate = 0; candidate < sizes.len; candidate++) {
+		key_lens[candidate] = size_entries[candidate].key;
+
+		if (key_lens[candidate] > histograms_len) {
+			histograms_len = key_lens[candidate];
+		}
+	}
+
+	histograms = malloc(histograms_len * sizeof *histograms);
+
+	if (histograms == NULL) {
+		ret = -ENOMEM;
+		goto exit;
+	}
+
+	cpal_analysis_top_init(&ranked, key_entries,
+			       count < candidates ? count : candidates);
+
+	for (size_t candidate = 0; candidate < sizes.len; candidate++) {
+		size_t key_len = key_lens[candidate];
+		struct analysis_column_job job = {model, histograms, len, key_len,
+						  NULL};
+
+		job.key = keys[candidate] = malloc(key_len);
+		if (job.key == NULL) {
+			ret = -ENOMEM;
+			goto exit;
+		}
+
+		// Every column is counted in one pass over the ciphertext, rather
+		// than transposing it into a copy per column
+		cpal_analysis_column_histograms(ciphertext, len, key_len, histograms);
+		cpal_pool_parallel_for(pool, 0, key_len, 1, analysis_solve_columns,
+				       &job);
+		key_len = analysis_key_period(job.key, key_len, min_key_len);
+
+		// Only rank each distinct key once
+		size_t prev = 0;
+
+		while (prev < candidate &&
+		       (keys[prev] == NULL || key_lens[prev] != key_len ||
+			memcmp(keys[prev], job.key, key_len) != 0)) {
+			prev++;
+		}
+
+		if (prev < candidate) {
+			free(keys[candidate]);
+			keys[candidate] = NULL;
+			continue;
+		}
+
+		// The key offered identifies the candidate, ordered by key length
+		// first so that equal scores go to the shorter key
+		uint64_t key_id =
+		    key_len * ANALYSIS_REPEATING_MAX_CANDIDATES + candidate;
+
+		key_lens[candidate] = key_len;
+		cpal_analysis_top_offer(&ranked,
+					cpal_analysis_score_xor(model, ciphertext, len,
+								job.key, key_len),
+					key_id, 0);
+	}
+
+	cpal_analysis_top_sort(&ranked);
+
+	for (; materialized < ranked.len; materialized++) {
+		struct cpal_analysis_key_score *score = &scores[materialized];
+		uint64_t key_id = key_entries[materialized].key;
+		size_t candidate = key_id % ANALYSIS_REPEATING_MAX_CANDIDATES;
+		size_t key_len = key_lens[candidate];
+
+		ret = cpal_cipher_xor_repeating(ciphertext, len, keys[candidate],
+						key_len, &score->decrypted);
+		if (ret < 0) {
+			goto exit;
+		}
+
+		score->key = keys[candidate];
+		score->key_len = key_len;
+		score->decrypted_len = len;
+		score->score = key_entries[materialized].score;
+		keys[candidate] = NULL;
+	}
+
+	ret = (int)materialized;
+exit:
+	if (ret < 0) {
+		while (materialized-- > 0) {
+			free(scores[materialized].key);
+			free(scores[materialized].decrypted);
+		}
+	}
+
+	for (size_t candidate = 0; candidate < sizes.len; candidate++) {
+		free(keys[candidate]);
+	}
+
+	free(histograms);
+	return ret;
+}
+
+double cpal_analysis_bhattacharyya_score(const double table[256],
+					 const uint8_t *decrypted, const size_t len)
+{
+	struct cpal_analysis_model model;
+
+	cpal_analysis_model_init(&model, table);
+	return cpal_analysis_model_score(&model, decrypted, len);
 }
 
 #define LETTER(table, letter, freq)                                                \
@@ -114,3 +1094,31 @@ void cpal_analysis_init_english_probabilities(double table[256])
 	LETTER(table, 'y', 0.01974)
 	LETTER(table, 'z', 0.00074)
 }
+
+/**
+ * The English models handed out by @cpal_analysis_english_model, one for each
+ * scorer.
+ */
+static struct cpal_analysis_model analysis_english_models[3];
+
+__attribute__((constructor)) static void analysis_init_english_models(void)
+{
+	double table[256];
+
+	cpal_analysis_init_english_probabilities(table);
+
+	for (unsigned int scorer = 0; scorer < 3; scorer++) {
+		cpal_analysis_model_init_scorer(&analysis_english_models[scorer], table,
+						(enum cpal_analysis_scorer)scorer);
+	}
+}
+
+const struct cpal_analysis_model *
+cpal_analysis_english_model(const enum cpal_analysis_scorer scorer)
+{
+	if ((unsigned int)scorer >= 3) {
+		return NULL;
+	}
+
+	return &analysis_english_models[scorer];
+}
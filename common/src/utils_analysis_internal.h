@@ -0,0 +1,354 @@
+#ifndef CRYPTOPAL_UTILS_ANALYSIS_INTERNAL_H
+#define CRYPTOPAL_UTILS_ANALYSIS_INTERNAL_H
+
+#include <cryptopal-common.h>
+
+#include <stdint.h>
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * The probability given to byte values a table gives none, so that a single
+ * unexpected byte doesn't make a plaintext impossible.
+ */
+#define ANALYSIS_MIN_PROBABILITY 1e-5
+
+/**
+ * The fixed-point scales of the log-likelihood and chi-squared weights.  Chi-
+ * squared weights are 1 / p, up to 1 / @ANALYSIS_MIN_PROBABILITY, so they are
+ * kept coarser to leave room for squared counts in the sums.
+ */
+#define ANALYSIS_LOG_LIKELIHOOD_SCALE 65536.0
+#define ANALYSIS_CHI_SQUARED_SCALE 256.0
+
+/**
+ * The longest plaintext whose chi-squared sum, at most len * len times the
+ * largest weight, is computed exactly in 64-bit integers.
+ */
+#define ANALYSIS_CHI_SQUARED_MAX_EXACT_LEN (1UL << 19)
+
+/**
+ * Turn the weighted sum @dot of a plaintext of @len bytes into its score.  For
+ * chi-squared, @dot is the sum of count * count / p, and the statistic is @dot /
+ * len - len.
+ */
+static inline double analysis_weighted_score(const struct cpal_analysis_model *model,
+					     const double dot, const size_t len)
+{
+	if (model->scorer == CPAL_ANALYSIS_LOG_LIKELIHOOD) {
+		return dot / ((double)len * ANALYSIS_LOG_LIKELIHOOD_SCALE);
+	}
+
+	return 1.0 - dot / ((double)len * (double)len * ANALYSIS_CHI_SQUARED_SCALE);
+}
+
+/*
+ * The pieces fused key searches are built from.  A cipher turns ciphertext bytes
+ * into plaintext bytes one at a time:
+ *
+ *	analysis_<cipher>_begin(state, key, key_len)
+ *	analysis_<cipher>_next(state, byte) -> plaintext byte
+ *
+ * and a scorer accumulates plaintext bytes one at a time:
+ *
+ *	analysis_<scorer>_begin(state)
+ *	analysis_<scorer>_add(model, state, byte)
+ *	analysis_<scorer>_end(model, state, len) -> score
+ *	analysis_<scorer>_below(model, state, pos, len, threshold) -> whether a
+ *	    plaintext of len bytes starting with the pos bytes added so far must
+ *	    score below threshold
+ *
+ * Every step is static inline, so the loop generated for a (cipher, scorer) pair
+ * decrypts and scores in a single pass with no indirect calls.
+ */
+
+/**
+ * Repeating-key XOR.
+ */
+struct analysis_xor_cipher {
+	const uint8_t *key;
+	size_t key_len;
+	size_t pos;
+};
+
+static inline void analysis_xor_begin(struct analysis_xor_cipher *cipher,
+				      const uint8_t *key, const size_t key_len)
+{
+	cipher->key = key;
+	cipher->key_len = key_len;
+	cipher->pos = 0;
+}
+
+static inline uint8_t analysis_xor_next(struct analysis_xor_cipher *cipher,
+					const uint8_t byte)
+{
+	uint8_t decrypted = byte ^ cipher->key[cipher->pos];
+
+	if (++cipher->pos == cipher->key_len) {
+		cipher->pos = 0;
+	}
+
+	return decrypted;
+}
+
+/**
+ * Any scorer that works from the byte histogram of the whole plaintext, which is
+ * the Bhattacharyya and chi-squared scorers.
+ */
+struct analysis_histogram_scorer {
+	size_t histogram[256];
+};
+
+static inline void analysis_histogram_begin(struct analysis_histogram_scorer *scorer)
+{
+	memset(scorer->histogram, 0, sizeof(scorer->histogram));
+}
+
+static inline void analysis_histogram_add(const struct cpal_analysis_model *model,
+					  struct analysis_histogram_scorer *scorer,
+					  const uint8_t byte)
+{
+	(void)model;
+	scorer->histogram[byte]++;
+}
+
+static inline double analysis_histogram_end(const struct cpal_analysis_model *model,
+					    struct analysis_histogram_scorer *scorer,
+					    const size_t len)
+{
+	return cpal_analysis_model_score_histogram(model, scorer->histogram, len);
+}
+
+/**
+ * For chi-squared, every byte added only increases the sum of count * count / p,
+ * so the histogram so far scored as a plaintext of @len bytes is a bound.  For
+ * Bhattacharyya, sqrt(count + x) <= sqrt(count) + sqrt(x), and by Cauchy-Schwarz
+ * the remaining bytes add at most sqrt(sum of p) * sqrt(len - pos).  The bytes
+ * so far add at most sqrt(sum of p) * sqrt(pos) in the same way, which rules
+ * most checks out before any square roots of counts are taken.
+ *
+ * Both bounds have to allow for the rest of the plaintext being as English as
+ * can be, and the rest outweighs a short prefix in either score, so they seldom
+ * drop a key before most of its plaintext has been scored.
+ */
+static inline int analysis_histogram_below(const struct cpal_analysis_model *model,
+					   struct analysis_histogram_scorer *scorer,
+					   const size_t pos, const size_t len,
+					   const double threshold)
+{
+	// Past ANALYSIS_CHI_SQUARED_MAX_EXACT_LEN bytes, the sum is taken in
+	// doubles, as it could overflow 64-bit integers
+	if (model->scorer == CPAL_ANALYSIS_CHI_SQUARED) {
+		return cpal_analysis_model_score_histogram(model, scorer->histogram,
+							   len) < threshold;
+	}
+
+	double sqrt_total = sqrt(model->total_probability);
+	double rest = sqrt_total * sqrt((double)(len - pos));
+	double dot = 0.0;
+
+	// Even the most English bytes so far couldn't reach the threshold
+	if ((sqrt_total * sqrt((double)pos) + rest) / sqrt((double)len) <
+	    threshold) {
+		return 1;
+	}
+
+	// The rest of the plaintext alone could reach it
+	if (!(rest / sqrt((double)len) < threshold)) {
+		return 0;
+	}
+
+	for (unsigned int val = 0; val < 256; val++) {
+		if (scorer->histogram[val] != 0) {
+			dot += model->sqrt_probabilities[val] *
+			       sqrt((double)scorer->histogram[val]);
+		}
+	}
+
+	return (dot + rest) / sqrt((double)len) < threshold;
+}
+
+/**
+ * The log-likelihood scorer, which is a sum of one weight per byte and so needs
+ * no histogram at all.
+ */
+struct analysis_log_likelihood_scorer {
+	int64_t dot;
+};
+
+static inline void
+analysis_log_likelihood_begin(struct analysis_log_likelihood_scorer *scorer)
+{
+	scorer->dot = 0;
+}
+
+static inline void
+analysis_log_likelihood_add(const struct cpal_analysis_model *model,
+			    struct analysis_log_likelihood_scorer *scorer,
+			    const uint8_t byte)
+{
+	scorer->dot += model->weights[byte];
+}
+
+static inline double
+analysis_log_likelihood_end(const struct cpal_analysis_model *model,
+			    struct analysis_log_likelihood_scorer *scorer,
+			    const size_t len)
+{
+	return len > 0 ? analysis_weighted_score(model, (double)scorer->dot, len)
+		       : 0.0;
+}
+
+/**
+ * The remaining bytes add at most the largest weight each.
+ */
+static inline int
+analysis_log_likelihood_below(const struct cpal_analysis_model *model,
+			      struct analysis_log_likelihood_scorer *scorer,
+			      const size_t pos, const size_t len,
+			      const double threshold)
+{
+	double best = (double)scorer->dot +
+		      (double)model->max_weight * (double)(len - pos);
+
+	return analysis_weighted_score(model, best, len) < threshold;
+}
+
+/**
+ * The first number of bytes after which a pruned search may drop a candidate,
+ * and the number of bytes before each check whose printable ratio is looked at.
+ * Candidates are checked again each time the number of bytes scored doubles, so
+ * a survivor pays for only a logarithmic number of checks.
+ */
+#define ANALYSIS_PRUNE_BLOCK 32
+
+/**
+ * Whether @byte is printable ASCII or common whitespace.  Branch-free, so the
+ * loops counting printable bytes vectorize.
+ */
+static inline unsigned int analysis_printable(const uint8_t byte)
+{
+	return ((uint8_t)(byte - 0x20) < 0x5f) | (byte == '\n') | (byte == '\r') |
+	       (byte == '\t');
+}
+
+/**
+ * Define @name##_score, which scores the plaintext decrypting a ciphertext with a
+ * single key would give, @name##_search, which offers the score of each of a
+ * packed array of keys to a top-K collector, and @name##_search_pruned, which
+ * drops keys part of the way through when they can't be kept, for the given
+ * @cipher and @scorer.
+ */
+#define ANALYSIS_DEFINE_SEARCH(name, cipher, scorer)                               \
+	static double name##_score(                                                \
+	    const struct cpal_analysis_model *model, const uint8_t *ciphertext,    \
+	    const size_t len, const uint8_t *key, const size_t key_len)            \
+	{                                                                          \
+		struct analysis_##cipher##_cipher cipher_state;                    \
+		struct analysis_##scorer##_scorer scorer_state;                    \
+                                                                                   \
+		analysis_##cipher##_begin(&cipher_state, key, key_len);            \
+		analysis_##scorer##_begin(&scorer_state);                          \
+                                                                                   \
+		for (size_t pos = 0; pos < len; pos++) {                           \
+			analysis_##scorer##_add(                                   \
+			    model, &scorer_state,                                  \
+			    analysis_##cipher##_next(&cipher_state,                \
+						     ciphertext[pos]));            \
+		}                                                                  \
+                                                                                   \
+		return analysis_##scorer##_end(model, &scorer_state, len);         \
+	}                                                                          \
+                                                                                   \
+	static void name##_search(const struct cpal_analysis_model *model,         \
+				  const uint8_t *ciphertext, const size_t len,     \
+				  const uint8_t *keys, const size_t key_len,       \
+				  const size_t key_count, const size_t idx,        \
+				  struct cpal_analysis_top *top)                   \
+	{                                                                          \
+		for (size_t candidate = 0; candidate < key_count; candidate++) {   \
+			cpal_analysis_top_offer(                                   \
+			    top,                                                   \
+			    name##_score(model, ciphertext, len,                   \
+					 keys + candidate * key_len, key_len),     \
+			    candidate, idx);                                       \
+		}                                                                  \
+	}                                                                          \
+                                                                                   \
+	static size_t name##_search_pruned(                                        \
+	    const struct cpal_analysis_model *model, const uint8_t *ciphertext,    \
+	    const size_t len, const uint8_t *keys, const size_t key_len,           \
+	    const size_t key_count, const size_t idx,                              \
+	    struct cpal_analysis_top *top, const double min_printable)             \
+	{                                                                          \
+		size_t pruned = 0;                                                 \
+                                                                                   \
+		for (size_t candidate = 0; candidate < key_count; candidate++) {   \
+			struct analysis_##cipher##_cipher cipher_state;            \
+			struct analysis_##scorer##_scorer scorer_state;            \
+			uint8_t block[ANALYSIS_PRUNE_BLOCK];                       \
+			size_t checkpoint = ANALYSIS_PRUNE_BLOCK;                  \
+			size_t pos = 0;                                            \
+                                                                                   \
+			analysis_##cipher##_begin(&cipher_state,                   \
+						  keys + candidate * key_len,      \
+						  key_len);                        \
+			analysis_##scorer##_begin(&scorer_state);                  \
+                                                                                   \
+			while (pos < len) {                                        \
+				size_t end = checkpoint < len ? checkpoint : len;  \
+				uint8_t printable = 0;                             \
+                                                                                   \
+				for (; end - pos > ANALYSIS_PRUNE_BLOCK; pos++) {  \
+					analysis_##scorer##_add(                   \
+					    model, &scorer_state,                  \
+					    analysis_##cipher##_next(              \
+						&cipher_state, ciphertext[pos]));  \
+				}                                                  \
+                                                                                   \
+				size_t block_len = end - pos;                      \
+                                                                                   \
+				for (size_t i = 0; i < block_len; i++) {           \
+					block[i] = analysis_##cipher##_next(       \
+					    &cipher_state, ciphertext[pos + i]);   \
+					analysis_##scorer##_add(model,             \
+								&scorer_state,     \
+								block[i]);         \
+				}                                                  \
+                                                                                   \
+				for (size_t i = 0; i < block_len; i++) {           \
+					printable += analysis_printable(block[i]); \
+				}                                                  \
+                                                                                   \
+				pos = end;                                         \
+				checkpoint *= 2;                                   \
+                                                                                   \
+				if (pos == len) {                                  \
+					break;                                     \
+				}                                                  \
+                                                                                   \
+				if ((double)printable <                            \
+					min_printable * block_len ||               \
+				    analysis_##scorer##_below(                     \
+					model, &scorer_state, pos, len,            \
+					cpal_analysis_top_threshold(top))) {       \
+					break;                                     \
+				}                                                  \
+			}                                                          \
+                                                                                   \
+			if (pos < len) {                                           \
+				pruned++;                                          \
+				continue;                                          \
+			}                                                          \
+                                                                                   \
+			double score =                                             \
+			    analysis_##scorer##_end(model, &scorer_state, len);    \
+                                                                                   \
+			cpal_analysis_top_offer(top, score, candidate, idx);       \
+		}                                                                  \
+                                                                                   \
+		return pruned;                                                     \
+	}
+
+#endif
@@ -0,0 +1,111 @@
+/*
+ * A bump allocator for short-lived buffers which are all freed at once.
+ *
+ * Memory comes from a chain of large blocks.  Resetting the arena keeps the
+ * blocks and starts handing them out again from the first, so a search which
+ * resets the arena between rounds stops calling malloc() after its first round.
+ */
+
+#include <cryptopal-common.h>
+
+#include <stdlib.h>
+
+struct cpal_arena_block {
+	struct cpal_arena_block *next;
+	size_t size;
+	size_t used;
+	max_align_t data[];
+};
+
+/**
+ * Every allocation is aligned for any type, like malloc()'s.
+ */
+#define ARENA_ALIGN (_Alignof(max_align_t))
+
+void cpal_arena_init(struct cpal_arena *arena, const size_t block_size)
+{
+	arena->head = NULL;
+	arena->current = NULL;
+	arena->block_size = block_size > 0 ? block_size : CPAL_ARENA_DEFAULT_BLOCK_SIZE;
+}
+
+static struct cpal_arena_block *arena_block_new(size_t size)
+{
+	struct cpal_arena_block *block = malloc(sizeof(*block) + size);
+
+	if (block == NULL) {
+		return NULL;
+	}
+
+	block->next = NULL;
+	block->size = size;
+	block->used = 0;
+	return block;
+}
+
+void *cpal_arena_alloc(struct cpal_arena *arena, const size_t size)
+{
+	size_t aligned = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+	struct cpal_arena_block *block = arena->current;
+
+	if (aligned < size) {
+		return NULL;
+	}
+
+	// Move on through the blocks kept from before the last reset, and only
+	// allocate a new one once they run out
+	while (block != NULL && block->size - block->used < aligned) {
+		block = block->next;
+
+		if (block != NULL) {
+			block->used = 0;
+		}
+	}
+
+	if (block == NULL) {
+		block = arena_block_new(aligned > arena->block_size ? aligned
+								    : arena->block_size);
+		if (block == NULL) {
+			return NULL;
+		}
+
+		if (arena->current == NULL) {
+			block->next = arena->head;
+			arena->head = block;
+		} else {
+			block->next = arena->current->next;
+			arena->current->next = block;
+		}
+	}
+
+	arena->current = block;
+
+	void *ptr = (uint8_t *)block->data + block->used;
+
+	block->used += aligned;
+	return ptr;
+}
+
+void cpal_arena_reset(struct cpal_arena *arena)
+{
+	arena->current = arena->head;
+
+	if (arena->current != NULL) {
+		arena->current->used = 0;
+	}
+}
+
+void cpal_arena_free(struct cpal_arena *arena)
+{
+	struct cpal_arena_block *block = arena->head;
+
+	while (block != NULL) {
+		struct cpal_arena_block *next = block->next;
+
+		free(block);
+		block = next;
+	}
+
+	arena->head = NULL;
+	arena->current = NULL;
+}
@@ -0,0 +1,300 @@
+/*
+ * Hamming distances between buffers, for CPUs with POPCNT, AVX2 or AVX-512
+ * VPOPCNTDQ.
+ *
+ * - POPCNT counts a 64-bit word at a time, with four independent sums so the
+ *   counts don't wait on each other.
+ * - AVX2 has no population count, so each nibble of the XOR is looked up in a
+ *   16 entry table with pshufb and the byte counts summed with psadbw.  Four
+ *   vectors of byte counts are added together before summing, which can't
+ *   overflow a byte.
+ * - VPOPCNTDQ counts whole 64-bit lanes directly.
+ *
+ * Pairwise matrices are computed a tile of blocks at a time, so both tiles of
+ * blocks being compared stay in cache while every pair between them is counted.
+ */
+
+#include "utils_hamming_internal.h"
+
+#include <cryptopal-common.h>
+
+#include <errno.h>
+#include <immintrin.h>
+#include <string.h>
+
+#define POPCNT __attribute__((target("popcnt")))
+#define AVX2 __attribute__((target("avx2,popcnt")))
+#define AVX512 __attribute__((target("avx512f,avx512bw,avx512vpopcntdq,bmi2")))
+
+/**
+ * The number of bytes of blocks making up a tile of a pairwise matrix.  Two
+ * tiles are compared at once, and together fit comfortably in L1.
+ */
+#define HAMMING_TILE_BYTES (12 * 1024)
+
+static hamming_kernel_fn hamming_kernel;
+
+static uint64_t hamming_scalar(const uint8_t *a, const uint8_t *b, size_t len)
+{
+	uint64_t distance = 0;
+	size_t pos = 0;
+
+	for (; len - pos >= 8; pos += 8) {
+		uint64_t x, y;
+
+		memcpy(&x, a + pos, sizeof(x));
+		memcpy(&y, b + pos, sizeof(y));
+		distance += __builtin_popcountll(x ^ y);
+	}
+
+	for (; pos < len; pos++) {
+		distance += __builtin_popcount(a[pos] ^ b[pos]);
+	}
+
+	return distance;
+}
+
+POPCNT static uint64_t hamming_popcnt(const uint8_t *a, const uint8_t *b,
+				      size_t len)
+{
+	uint64_t sums[4] = {0};
+	size_t pos = 0;
+
+	for (; len - pos >= 32; pos += 32) {
+		for (size_t lane = 0; lane < 4; lane++) {
+			uint64_t x, y;
+
+			memcpy(&x, a + pos + lane * 8, sizeof(x));
+			memcpy(&y, b + pos + lane * 8, sizeof(y));
+			sums[lane] += __builtin_popcountll(x ^ y);
+		}
+	}
+
+	for (; len - pos >= 8; pos += 8) {
+		uint64_t x, y;
+
+		memcpy(&x, a + pos, sizeof(x));
+		memcpy(&y, b + pos, sizeof(y));
+		sums[0] += __builtin_popcountll(x ^ y);
+	}
+
+	for (; pos < len; pos++) {
+		sums[0] += __builtin_popcount(a[pos] ^ b[pos]);
+	}
+
+	return sums[0] + sums[1] + sums[2] + sums[3];
+}
+
+/**
+ * The number of bits set in each byte of @v.
+ */
+AVX2 static inline __m256i hamming_byte_counts_avx2(__m256i v)
+{
+	const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2,
+					       3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2,
+					       2, 3, 2, 3, 3, 4);
+	const __m256i low_nibbles = _mm256_set1_epi8(0x0f);
+	__m256i lo = _mm256_and_si256(v, low_nibbles);
+	__m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibbles);
+
+	return _mm256_add_epi8(_mm256_shuffle_epi8(table, lo),
+			       _mm256_shuffle_epi8(table, hi));
+}
+
+AVX2 static uint64_t hamming_avx2(const uint8_t *a, const uint8_t *b, size_t len)
+{
+	__m256i sums = _mm256_setzero_si256();
+	size_t pos = 0;
+
+	for (; len - pos >= 128; pos += 128) {
+		__m256i counts = _mm256_setzero_si256();
+
+		for (size_t off = pos; off < pos + 128; off += 32) {
+			__m256i x = _mm256_loadu_si256((const __m256i *)(a + off));
+			__m256i y = _mm256_loadu_si256((const __m256i *)(b + off));
+
+			counts = _mm256_add_epi8(
+			    counts, hamming_byte_counts_avx2(_mm256_xor_si256(x, y)));
+		}
+
+		sums = _mm256_add_epi64(sums,
+					_mm256_sad_epu8(counts, _mm256_setzero_si256()));
+	}
+
+	for (; len - pos >= 32; pos += 32) {
+		__m256i x = _mm256_loadu_si256((const __m256i *)(a + pos));
+		__m256i y = _mm256_loadu_si256((const __m256i *)(b + pos));
+		__m256i counts = hamming_byte_counts_avx2(_mm256_xor_si256(x, y));
+
+		sums = _mm256_add_epi64(sums,
+					_mm256_sad_epu8(counts, _mm256_setzero_si256()));
+	}
+
+	uint64_t distance = (uint64_t)_mm256_extract_epi64(sums, 0) +
+			    (uint64_t)_mm256_extract_epi64(sums, 1) +
+			    (uint64_t)_mm256_extract_epi64(sums, 2) +
+			    (uint64_t)_mm256_extract_epi64(sums, 3);
+
+	return distance + hamming_popcnt(a + pos, b + pos, len - pos);
+}
+
+AVX512 static uint64_t hamming_avx512(const uint8_t *a, const uint8_t *b,
+				      size_t len)
+{
+	__m512i sums[2] = {_mm512_setzero_si512(), _mm512_setzero_si512()};
+	size_t pos = 0;
+
+	for (; len - pos >= 128; pos += 128) {
+		for (size_t lane = 0; lane < 2; lane++) {
+			__m512i x = _mm512_loadu_si512(a + pos + lane * 64);
+			__m512i y = _mm512_loadu_si512(b + pos + lane * 64);
+
+			sums[lane] = _mm512_add_epi64(
+			    sums[lane], _mm512_popcnt_epi64(_mm512_xor_si512(x, y)));
+		}
+	}
+
+	if (len - pos >= 64) {
+		__m512i x = _mm512_loadu_si512(a + pos);
+		__m512i y = _mm512_loadu_si512(b + pos);
+
+		sums[0] = _mm512_add_epi64(sums[0],
+					   _mm512_popcnt_epi64(_mm512_xor_si512(x, y)));
+		pos += 64;
+	}
+
+	// The tail is loaded under a mask, which reads as zeroes past the end
+	if (pos < len) {
+		__mmask64 mask = _bzhi_u64(~0ULL, len - pos);
+		__m512i x = _mm512_maskz_loadu_epi8(mask, a + pos);
+		__m512i y = _mm512_maskz_loadu_epi8(mask, b + pos);
+
+		sums[1] = _mm512_add_epi64(sums[1],
+					   _mm512_popcnt_epi64(_mm512_xor_si512(x, y)));
+	}
+
+	return _mm512_reduce_add_epi64(_mm512_add_epi64(sums[0], sums[1]));
+}
+
+static int hamming_avx512_supported(void)
+{
+	return __builtin_cpu_supports("avx512vpopcntdq") &&
+	       __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("bmi2");
+}
+
+static int hamming_avx2_supported(void)
+{
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+}
+
+static int hamming_popcnt_supported(void)
+{
+	return __builtin_cpu_supports("popcnt");
+}
+
+static int hamming_scalar_supported(void)
+{
+	return 1;
+}
+
+const struct hamming_kernel_entry hamming_kernels[] = {
+    {"avx512", hamming_avx512, hamming_avx512_supported},
+    {"avx2", hamming_avx2, hamming_avx2_supported},
+    {"popcnt", hamming_popcnt, hamming_popcnt_supported},
+    {"scalar", hamming_scalar, hamming_scalar_supported},
+};
+
+const size_t hamming_kernel_count =
+    sizeof(hamming_kernels) / sizeof(hamming_kernels[0]);
+
+/**
+ * Select the kernel once, when the library is loaded.
+ */
+__attribute__((constructor)) static void hamming_select_kernel(void)
+{
+	size_t i = 0;
+
+	__builtin_cpu_init();
+
+	while (!hamming_kernels[i].supported()) {
+		i++;
+	}
+
+	hamming_kernel = hamming_kernels[i].kernel;
+}
+
+uint64_t cpal_hamming_distance(const uint8_t *a, const uint8_t *b, const size_t len)
+{
+	return hamming_kernel(a, b, len);
+}
+
+/**
+ * A pairwise matrix being filled in, a row of tiles at a time.
+ */
+struct hamming_matrix_job {
+	const uint8_t *blocks;
+	size_t block_len;
+	size_t count;
+	size_t tile;
+	uint64_t *matrix;
+};
+
+static void hamming_matrix_rows(void *arg, size_t begin, size_t end)
+{
+	const struct hamming_matrix_job *job = arg;
+	size_t count = job->count;
+
+	for (size_t row_tile = begin; row_tile < end; row_tile++) {
+		size_t row_start = row_tile * job->tile;
+		size_t row_end = row_start + job->tile < count ? row_start + job->tile
+							       : count;
+
+		// Only the tiles on and above the diagonal are counted, and every
+		// distance is mirrored below it
+		for (size_t col_start = row_start; col_start < count;
+		     col_start += job->tile) {
+			size_t col_end = col_start + job->tile < count
+					     ? col_start + job->tile
+					     : count;
+
+			for (size_t i = row_start; i < row_end; i++) {
+				const uint8_t *a = job->blocks + i * job->block_len;
+				size_t j = col_start > i + 1 ? col_start : i + 1;
+
+				job->matrix[i * count + i] = 0;
+
+				for (; j < col_end; j++) {
+					uint64_t distance = hamming_kernel(
+					    a, job->blocks + j * job->block_len,
+					    job->block_len);
+
+					job->matrix[i * count + j] = distance;
+					job->matrix[j * count + i] = distance;
+				}
+			}
+		}
+	}
+}
+
+int cpal_hamming_distance_matrix(const uint8_t *blocks, const size_t block_len,
+				 const size_t count, uint64_t *matrix,
+				 struct cpal_pool *pool)
+{
+	if ((blocks == NULL || matrix == NULL) && count > 0) {
+		return -EINVAL;
+	}
+
+	size_t tile = block_len > 0 ? HAMMING_TILE_BYTES / block_len : count;
+
+	if (tile == 0) {
+		tile = 1;
+	}
+
+	struct hamming_matrix_job job = {blocks, block_len, count, tile, matrix};
+
+	// Rows near the top of the matrix have the most tiles to the right of
+	// the diagonal, so they are handed out one row of tiles at a time
+	cpal_pool_parallel_for(pool, 0, (count + tile - 1) / tile, 1,
+			       hamming_matrix_rows, &job);
+	return 0;
+}
@@ -0,0 +1,34 @@
+#ifndef CRYPTOPAL_UTILS_HAMMING_INTERNAL_H
+#define CRYPTOPAL_UTILS_HAMMING_INTERNAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Count the bits which differ between the @len bytes of @a and @b.
+ */
+typedef uint64_t (*hamming_kernel_fn)(const uint8_t *a, const uint8_t *b,
+				      size_t len);
+
+/**
+ * A Hamming distance kernel, with a check of whether the running CPU has the
+ * instructions it needs.
+ */
+struct hamming_kernel_entry {
+	const char *name;
+	hamming_kernel_fn kernel;
+	int (*supported)(void);
+};
+
+/**
+ * Every Hamming distance kernel, fastest first, ending with the portable one
+ * which is always supported.  The first the CPU supports is selected once when
+ * the library is loaded.  The rest are only listed so they can be checked
+ * against each other, by checks which link the object directly, so the table is
+ * hidden from the library's exported symbols.
+ */
+extern __attribute__((visibility("hidden"))) const struct hamming_kernel_entry
+    hamming_kernels[];
+extern __attribute__((visibility("hidden"))) const size_t hamming_kernel_count;
+
+#endif
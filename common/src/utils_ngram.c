@@ -0,0 +1,365 @@
+/*
+ * N-gram language models stored in a file laid out exactly as it is used, so
+ * opening a model is a single mmap with nothing to parse.
+ *
+ * Bytes are first mapped to one of 2^class_bits classes, and the classes of the
+ * last order - 1 bytes packed into a context index.  Shifting the class of the
+ * next byte into the context gives the index of its log-probability in the
+ * table, so scoring is one lookup per byte:
+ *
+ *	index = ((index << class_bits) | class_map[byte]) & (table_len - 1)
+ *	score += log_probabilities[index]
+ *
+ * The file is a struct ngram_file_header followed by the table of 2^(class_bits *
+ * order) 16-bit fixed-point log-probabilities, in host byte order.
+ */
+
+#include "utils_analysis_internal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define NGRAM_MAGIC "CPALNGRM"
+#define NGRAM_VERSION 1
+
+/**
+ * The largest table a model may have, 32 MiB of log-probabilities.
+ */
+#define NGRAM_MAX_TABLE_BITS 24
+
+/**
+ * The fixed-point scale of the log-probabilities.  Even with a corpus of 2^32
+ * bytes, a smoothed probability is no smaller than about e^-23, which still fits
+ * in 16 bits at this scale.
+ */
+#define NGRAM_SCALE 1024.0
+
+/**
+ * The class of a space in the English class map.  Models treat the start of a
+ * text as though it followed spaces.
+ */
+#define NGRAM_ENGLISH_SPACE 26
+
+struct ngram_file_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t order;
+	uint32_t class_bits;
+	uint32_t boundary;
+	uint32_t scale;
+	uint32_t reserved;
+	uint8_t class_map[256];
+};
+
+/**
+ * The context of a text's first byte, as though it followed order - 1 bytes of
+ * the boundary class.
+ */
+static size_t ngram_start_index(const uint32_t order, const uint32_t class_bits,
+				const uint32_t boundary)
+{
+	size_t index = 0;
+
+	for (uint32_t i = 1; i < order; i++) {
+		index = (index << class_bits) | boundary;
+	}
+
+	return index;
+}
+
+static int ngram_valid_shape(const uint32_t order, const uint32_t class_bits,
+			     const uint32_t boundary, const uint8_t class_map[256])
+{
+	// Bound the order first, so a hostile header can't wrap the product
+	if (order == 0 || order > NGRAM_MAX_TABLE_BITS || class_bits == 0 ||
+	    class_bits > 8 || order * class_bits > NGRAM_MAX_TABLE_BITS ||
+	    boundary >= (1U << class_bits)) {
+		return 0;
+	}
+
+	for (unsigned int val = 0; val < 256; val++) {
+		if (class_map[val] >= (1U << class_bits)) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+unsigned int cpal_ngram_english_classes(uint8_t class_map[256])
+{
+	for (unsigned int val = 0; val < 256; val++) {
+		if (val >= 'a' && val <= 'z') {
+			class_map[val] = val - 'a';
+		} else if (val >= 'A' && val <= 'Z') {
+			class_map[val] = val - 'A';
+		} else if (val == ' ') {
+			class_map[val] = NGRAM_ENGLISH_SPACE;
+		} else if (val >= '0' && val <= '9') {
+			class_map[val] = 27;
+		} else if (val == '\n' || val == '\r' || val == '\t') {
+			class_map[val] = 28;
+		} else if (val == '.' || val == ',' || val == '!' || val == '?' ||
+			   val == ';' || val == ':') {
+			class_map[val] = 29;
+		} else if (val > ' ' && val < 0x7f) {
+			class_map[val] = 30;
+		} else {
+			class_map[val] = 31;
+		}
+	}
+
+	return 5;
+}
+
+int cpal_ngram_model_build(const uint8_t *corpus, const size_t len,
+			   const uint8_t class_map[256],
+			   const unsigned int class_bits, const unsigned int order,
+			   const char *path)
+{
+	struct ngram_file_header *header = MAP_FAILED;
+	uint64_t class_counts[256] = {0};
+	uint64_t *counts = NULL;
+	uint64_t *context_counts = NULL;
+	size_t file_len = 0;
+	int fd = -1;
+	int ret = 0;
+
+	if ((corpus == NULL && len > 0) || class_map == NULL || path == NULL ||
+	    !ngram_valid_shape(order, class_bits, class_map[' '], class_map)) {
+		return -EINVAL;
+	}
+
+	size_t classes = (size_t)1 << class_bits;
+	size_t table_len = (size_t)1 << (class_bits * order);
+	size_t index = ngram_start_index(order, class_bits, class_map[' ']);
+
+	counts = calloc(table_len, sizeof *counts);
+	context_counts = calloc(table_len >> class_bits, sizeof *context_counts);
+
+	if (counts == NULL || context_counts == NULL) {
+		ret = -ENOMEM;
+		goto exit;
+	}
+
+	for (size_t pos = 0; pos < len; pos++) {
+		index = ((index << class_bits) | class_map[corpus[pos]]) &
+			(table_len - 1);
+		counts[index]++;
+		context_counts[index >> class_bits]++;
+		class_counts[class_map[corpus[pos]]]++;
+	}
+
+	file_len = sizeof(*header) + table_len * sizeof(int16_t);
+
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0 || ftruncate(fd, file_len) < 0) {
+		ret = -errno;
+		goto exit;
+	}
+
+	header = mmap(NULL, file_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (header == MAP_FAILED) {
+		ret = -errno;
+		goto exit;
+	}
+
+	memcpy(header->magic, NGRAM_MAGIC, sizeof(header->magic));
+	header->version = NGRAM_VERSION;
+	header->order = order;
+	header->class_bits = class_bits;
+	header->boundary = class_map[' '];
+	header->scale = (uint32_t)NGRAM_SCALE;
+	header->reserved = 0;
+	memcpy(header->class_map, class_map, sizeof(header->class_map));
+
+	int16_t *log_probabilities = (int16_t *)(header + 1);
+
+	// Add-one smoothing, so n-grams the corpus never had are unlikely rather
+	// than impossible.  Contexts the corpus never had fall back to how often
+	// each class occurs at all, rather than making every class equally likely
+	for (size_t i = 0; i < table_len; i++) {
+		uint64_t context_count = context_counts[i >> class_bits];
+		double p;
+
+		if (context_count > 0) {
+			p = (double)(counts[i] + 1) / (double)(context_count + classes);
+		} else {
+			p = (double)(class_counts[i & (classes - 1)] + 1) /
+			    (double)(len + classes);
+		}
+
+		double weight = round(log(p) * NGRAM_SCALE);
+
+		log_probabilities[i] = weight < INT16_MIN ? INT16_MIN : (int16_t)weight;
+	}
+
+	if (msync(header, file_len, MS_SYNC) < 0) {
+		ret = -errno;
+	}
+
+exit:
+	if (header != MAP_FAILED) {
+		munmap(header, file_len);
+	}
+
+	if (fd >= 0) {
+		close(fd);
+	}
+
+	free(counts);
+	free(context_counts);
+	return ret;
+}
+
+int cpal_ngram_model_open(struct cpal_ngram_model *model, const char *path)
+{
+	const struct ngram_file_header *header;
+	struct stat st;
+	void *mapping;
+	int ret = 0;
+
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0) {
+		return -errno;
+	}
+
+	if (fstat(fd, &st) < 0) {
+		ret = -errno;
+		goto exit;
+	}
+
+	if ((size_t)st.st_size < sizeof(*header)) {
+		ret = -EINVAL;
+		goto exit;
+	}
+
+	mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (mapping == MAP_FAILED) {
+		ret = -errno;
+		goto exit;
+	}
+
+	header = mapping;
+
+	if (memcmp(header->magic, NGRAM_MAGIC, sizeof(header->magic)) != 0 ||
+	    header->version != NGRAM_VERSION || header->scale == 0 ||
+	    !ngram_valid_shape(header->order, header->class_bits, header->boundary,
+			       header->class_map) ||
+	    (size_t)st.st_size != sizeof(*header) + (sizeof(int16_t)
+						      << (header->class_bits *
+							  header->order))) {
+		munmap(mapping, st.st_size);
+		ret = -EINVAL;
+		goto exit;
+	}
+
+	// Scoring walks the table at random, so have it all read in up front
+	madvise(mapping, st.st_size, MADV_WILLNEED);
+
+	model->class_map = header->class_map;
+	model->log_probabilities = (const int16_t *)(header + 1);
+	model->order = header->order;
+	model->class_bits = header->class_bits;
+	model->mask = ((size_t)1 << (header->class_bits * header->order)) - 1;
+	model->start = ngram_start_index(header->order, header->class_bits,
+					 header->boundary);
+	model->scale = header->scale;
+	model->mapping = mapping;
+	model->mapping_len = st.st_size;
+
+exit:
+	close(fd);
+	return ret;
+}
+
+void cpal_ngram_model_close(struct cpal_ngram_model *model)
+{
+	if (model->mapping != NULL) {
+		munmap(model->mapping, model->mapping_len);
+	}
+
+	model->mapping = NULL;
+	model->mapping_len = 0;
+}
+
+double cpal_ngram_model_score(const struct cpal_ngram_model *model,
+			      const uint8_t *data, const size_t len)
+{
+	const int16_t *log_probabilities = model->log_probabilities;
+	const uint8_t *class_map = model->class_map;
+	size_t index = model->start;
+	int64_t score = 0;
+
+	if (len == 0) {
+		return 0.0;
+	}
+
+	for (size_t pos = 0; pos < len; pos++) {
+		index = ((index << model->class_bits) | class_map[data[pos]]) &
+			model->mask;
+		score += log_probabilities[index];
+	}
+
+	return (double)score / ((double)len * model->scale);
+}
+
+double cpal_ngram_model_score_xor(const struct cpal_ngram_model *model,
+				  const uint8_t *ciphertext, const size_t len,
+				  const uint8_t *key, const size_t key_len)
+{
+	const int16_t *log_probabilities = model->log_probabilities;
+	const uint8_t *class_map = model->class_map;
+	struct analysis_xor_cipher cipher;
+	size_t index = model->start;
+	int64_t score = 0;
+
+	if (key_len == 0) {
+		return -INFINITY;
+	}
+
+	if (len == 0) {
+		return 0.0;
+	}
+
+	analysis_xor_begin(&cipher, key, key_len);
+
+	for (size_t pos = 0; pos < len; pos++) {
+		uint8_t byte = analysis_xor_next(&cipher, ciphertext[pos]);
+
+		index = ((index << model->class_bits) | class_map[byte]) & model->mask;
+		score += log_probabilities[index];
+	}
+
+	return (double)score / ((double)len * model->scale);
+}
+
+void cpal_ngram_model_rescore(const struct cpal_ngram_model *model,
+			      struct cpal_analysis_key_score *scores,
+			      const size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		scores[i].score = cpal_ngram_model_score(model, scores[i].decrypted,
+							 scores[i].decrypted_len);
+	}
+
+	// Only a handful of candidates are ever rescored, and an insertion sort
+	// keeps equal scores in their original order
+	for (size_t i = 1; i < count; i++) {
+		struct cpal_analysis_key_score score = scores[i];
+		size_t j = i;
+
+		for (; j > 0 && scores[j - 1].score < score.score; j--) {
+			scores[j] = scores[j - 1];
+		}
+
+		scores[j] = score;
+	}
+}
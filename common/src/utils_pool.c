@@ -0,0 +1,506 @@
+/*
+ * A work-stealing thread pool.
+ *
+ * Every worker owns a deque of tasks.  It pushes and pops the tasks it creates
+ * itself at the back, so it works depth-first on whatever is hot in its cache,
+ * and when its deque runs dry it steals from the front of the other deques,
+ * which holds the largest pieces of work left.  Tasks submitted from outside the
+ * pool go to a shared deque which every worker steals from.
+ *
+ * A parallel for splits its range in half, pushes the upper half as a task and
+ * carries on splitting the lower half until it is down to the grain size, so
+ * idle workers steal large ranges and only split them further when other work
+ * runs out.
+ *
+ * Threads waiting for a task group to finish run queued tasks rather than
+ * block, which keeps nested parallel fors from tying up workers.
+ */
+
+#include <cryptopal-common.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define POOL_MAX_THREADS 1024
+
+/**
+ * The initial number of tasks a deque has room for before it grows.
+ */
+#define POOL_DEQUE_INITIAL_CAPACITY 64
+
+/**
+ * A set of tasks that can be waited for together.
+ */
+struct pool_group {
+	atomic_size_t pending;
+};
+
+struct pool_range {
+	cpal_pool_range_fn fn;
+	void *arg;
+	size_t grain;
+};
+
+/**
+ * A queued task: either a submitted function, or the part of a parallel for
+ * @range from @begin to @end.
+ */
+struct pool_task {
+	cpal_pool_task_fn fn;
+	void *arg;
+	const struct pool_range *range;
+	size_t begin;
+	size_t end;
+	struct pool_group *group;
+};
+
+/**
+ * A ring buffer of tasks, @len long starting at @head.
+ */
+struct pool_deque {
+	pthread_mutex_t lock;
+	struct pool_task *tasks;
+	size_t capacity;
+	size_t head;
+	size_t len;
+};
+
+struct pool_worker {
+	struct cpal_pool *pool;
+	size_t idx;
+	pthread_t thread;
+};
+
+struct cpal_pool {
+	struct pool_worker *workers;
+	size_t worker_count;
+
+	// One deque per worker, followed by the shared deque for tasks from
+	// threads outside the pool
+	struct pool_deque *deques;
+	size_t deque_count;
+	atomic_size_t queued;
+
+	struct pool_group submitted;
+
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	atomic_size_t sleepers;
+	int stopping;
+};
+
+/**
+ * The worker running on this thread, or NULL outside of any pool.
+ */
+static __thread struct pool_worker *pool_self;
+
+static int pool_deque_push(struct pool_deque *deque, const struct pool_task *task)
+{
+	int ret = 0;
+
+	pthread_mutex_lock(&deque->lock);
+
+	if (deque->len == deque->capacity) {
+		size_t capacity = deque->capacity * 2;
+		struct pool_task *tasks = malloc(capacity * sizeof *tasks);
+
+		if (tasks == NULL) {
+			ret = -ENOMEM;
+			goto exit;
+		}
+
+		// Unwrap the ring into the start of the new buffer
+		for (size_t pos = 0; pos < deque->len; pos++) {
+			tasks[pos] = deque->tasks[(deque->head + pos) % deque->capacity];
+		}
+
+		free(deque->tasks);
+		deque->tasks = tasks;
+		deque->capacity = capacity;
+		deque->head = 0;
+	}
+
+	deque->tasks[(deque->head + deque->len++) % deque->capacity] = *task;
+
+exit:
+	pthread_mutex_unlock(&deque->lock);
+	return ret;
+}
+
+static int pool_deque_pop_back(struct pool_deque *deque, struct pool_task *task)
+{
+	int found = 0;
+
+	pthread_mutex_lock(&deque->lock);
+
+	if (deque->len > 0) {
+		*task = deque->tasks[(deque->head + --deque->len) % deque->capacity];
+		found = 1;
+	}
+
+	pthread_mutex_unlock(&deque->lock);
+	return found;
+}
+
+static int pool_deque_pop_front(struct pool_deque *deque, struct pool_task *task)
+{
+	int found = 0;
+
+	pthread_mutex_lock(&deque->lock);
+
+	if (deque->len > 0) {
+		*task = deque->tasks[deque->head];
+		deque->head = (deque->head + 1) % deque->capacity;
+		deque->len--;
+		found = 1;
+	}
+
+	pthread_mutex_unlock(&deque->lock);
+	return found;
+}
+
+/**
+ * Wake a thread sleeping on the pool, or every one of them with @all, after
+ * making more work or finishing a group.  Sleepers count themselves before
+ * checking whether to sleep, so either they see the change or it sees them, and
+ * the lock is only taken when someone is asleep.
+ */
+static void pool_wake(struct cpal_pool *pool, int all)
+{
+	if (atomic_load(&pool->sleepers) == 0) {
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+
+	if (all) {
+		pthread_cond_broadcast(&pool->wake);
+	} else {
+		pthread_cond_signal(&pool->wake);
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * Queue @task on the deque of the worker running this thread, or the shared
+ * deque from outside the pool.
+ */
+static int pool_push(struct cpal_pool *pool, const struct pool_task *task)
+{
+	size_t idx = pool->worker_count;
+
+	if (pool_self != NULL && pool_self->pool == pool) {
+		idx = pool_self->idx;
+	}
+
+	int err = pool_deque_push(&pool->deques[idx], task);
+
+	if (err < 0) {
+		return err;
+	}
+
+	atomic_fetch_add(&pool->queued, 1);
+	pool_wake(pool, 0);
+	return 0;
+}
+
+/**
+ * Take the next task for this thread: the newest of its own, or failing that
+ * the oldest of another deque.
+ */
+static int pool_take(struct cpal_pool *pool, struct pool_task *task)
+{
+	size_t start = 0;
+
+	if (pool_self != NULL && pool_self->pool == pool) {
+		if (pool_deque_pop_back(&pool->deques[pool_self->idx], task)) {
+			goto found;
+		}
+
+		start = pool_self->idx + 1;
+	}
+
+	for (size_t victim = 0; victim < pool->deque_count; victim++) {
+		struct pool_deque *deque = &pool->deques[(start + victim) %
+							 pool->deque_count];
+
+		if (pool_deque_pop_front(deque, task)) {
+			goto found;
+		}
+	}
+
+	return 0;
+found:
+	atomic_fetch_sub(&pool->queued, 1);
+	return 1;
+}
+
+static void pool_group_done(struct cpal_pool *pool, struct pool_group *group)
+{
+	// The group may be gone as soon as the count reaches 0, so only the
+	// pool is touched after it
+	if (atomic_fetch_sub(&group->pending, 1) == 1) {
+		pool_wake(pool, 1);
+	}
+}
+
+/**
+ * Run the part of @range from @begin to @end, pushing the upper half of it as
+ * a new task of @group until it is no larger than the grain size.
+ */
+static void pool_run_range(struct cpal_pool *pool, const struct pool_range *range,
+			   size_t begin, size_t end, struct pool_group *group)
+{
+	while (end - begin > range->grain) {
+		size_t mid = begin + (end - begin) / 2;
+		struct pool_task task = {NULL, NULL, range, mid, end, group};
+
+		atomic_fetch_add(&group->pending, 1);
+
+		// Out of memory, so run the rest of the range here instead
+		if (pool_push(pool, &task) < 0) {
+			atomic_fetch_sub(&group->pending, 1);
+			break;
+		}
+
+		end = mid;
+	}
+
+	range->fn(range->arg, begin, end);
+}
+
+static void pool_run(struct cpal_pool *pool, const struct pool_task *task)
+{
+	if (task->range != NULL) {
+		pool_run_range(pool, task->range, task->begin, task->end, task->group);
+	} else {
+		task->fn(task->arg);
+	}
+
+	pool_group_done(pool, task->group);
+}
+
+/**
+ * Run queued tasks until every task of @group has finished, sleeping only
+ * while there's nothing left to run.
+ */
+static void pool_wait(struct cpal_pool *pool, struct pool_group *group)
+{
+	struct pool_task task;
+
+	while (atomic_load(&group->pending) > 0) {
+		if (pool_take(pool, &task)) {
+			pool_run(pool, &task);
+			continue;
+		}
+
+		pthread_mutex_lock(&pool->lock);
+		atomic_fetch_add(&pool->sleepers, 1);
+
+		while (atomic_load(&group->pending) > 0 &&
+		       atomic_load(&pool->queued) == 0) {
+			pthread_cond_wait(&pool->wake, &pool->lock);
+		}
+
+		atomic_fetch_sub(&pool->sleepers, 1);
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+static void *pool_worker_main(void *arg)
+{
+	struct pool_worker *worker = arg;
+	struct cpal_pool *pool = worker->pool;
+	struct pool_task task;
+
+	pool_self = worker;
+
+	for (;;) {
+		if (pool_take(pool, &task)) {
+			pool_run(pool, &task);
+			continue;
+		}
+
+		pthread_mutex_lock(&pool->lock);
+		atomic_fetch_add(&pool->sleepers, 1);
+
+		while (!pool->stopping && atomic_load(&pool->queued) == 0) {
+			pthread_cond_wait(&pool->wake, &pool->lock);
+		}
+
+		int stop = pool->stopping && atomic_load(&pool->queued) == 0;
+
+		atomic_fetch_sub(&pool->sleepers, 1);
+		pthread_mutex_unlock(&pool->lock);
+
+		if (stop) {
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+int cpal_pool_create(struct cpal_pool **pool, unsigned int threads)
+{
+	struct cpal_pool *pool_tmp = NULL;
+	int ret = 0;
+
+	if (pool == NULL) {
+		return -EINVAL;
+	}
+
+	if (threads == 0) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		threads = cpus > 0 ? (unsigned int)cpus : 1;
+	}
+
+	if (threads > POOL_MAX_THREADS) {
+		threads = POOL_MAX_THREADS;
+	}
+
+	pool_tmp = calloc(1, sizeof *pool_tmp);
+	if (pool_tmp == NULL) {
+		return -ENOMEM;
+	}
+
+	atomic_init(&pool_tmp->queued, 0);
+	atomic_init(&pool_tmp->sleepers, 0);
+	atomic_init(&pool_tmp->submitted.pending, 0);
+	pthread_mutex_init(&pool_tmp->lock, NULL);
+	pthread_cond_init(&pool_tmp->wake, NULL);
+
+	// The thread waiting on the pool takes part, so it needs one less worker
+	pool_tmp->workers = calloc(threads - 1, sizeof *pool_tmp->workers);
+	pool_tmp->deques = calloc(threads, sizeof *pool_tmp->deques);
+
+	if ((pool_tmp->workers == NULL && threads > 1) || pool_tmp->deques == NULL) {
+		ret = -ENOMEM;
+		goto error;
+	}
+
+	for (; pool_tmp->deque_count < threads; pool_tmp->deque_count++) {
+		struct pool_deque *deque = &pool_tmp->deques[pool_tmp->deque_count];
+
+		deque->capacity = POOL_DEQUE_INITIAL_CAPACITY;
+		deque->tasks = malloc(deque->capacity * sizeof *deque->tasks);
+
+		if (deque->tasks == NULL) {
+			ret = -ENOMEM;
+			goto error;
+		}
+
+		pthread_mutex_init(&deque->lock, NULL);
+	}
+
+	for (; pool_tmp->worker_count < threads - 1; pool_tmp->worker_count++) {
+		struct pool_worker *worker = &pool_tmp->workers[pool_tmp->worker_count];
+
+		worker->pool = pool_tmp;
+		worker->idx = pool_tmp->worker_count;
+
+		if (pthread_create(&worker->thread, NULL, pool_worker_main, worker) !=
+		    0) {
+			ret = -EAGAIN;
+			goto error;
+		}
+	}
+
+	*pool = pool_tmp;
+	return 0;
+error:
+	cpal_pool_destroy(pool_tmp);
+	return ret;
+}
+
+void cpal_pool_destroy(struct cpal_pool *pool)
+{
+	if (pool == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stopping = 1;
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (size_t idx = 0; idx < pool->worker_count; idx++) {
+		pthread_join(pool->workers[idx].thread, NULL);
+	}
+
+	// Tasks left for a pool without workers still have to run
+	cpal_pool_join(pool);
+
+	for (size_t idx = 0; idx < pool->deque_count; idx++) {
+		pthread_mutex_destroy(&pool->deques[idx].lock);
+		free(pool->deques[idx].tasks);
+	}
+
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->wake);
+	free(pool->deques);
+	free(pool->workers);
+	free(pool);
+}
+
+unsigned int cpal_pool_threads(const struct cpal_pool *pool)
+{
+	return pool != NULL ? (unsigned int)pool->deque_count : 1;
+}
+
+int cpal_pool_submit(struct cpal_pool *pool, cpal_pool_task_fn fn, void *arg)
+{
+	if (pool == NULL) {
+		fn(arg);
+		return 0;
+	}
+
+	struct pool_task task = {fn, arg, NULL, 0, 0, &pool->submitted};
+
+	atomic_fetch_add(&pool->submitted.pending, 1);
+
+	int err = pool_push(pool, &task);
+
+	if (err < 0) {
+		atomic_fetch_sub(&pool->submitted.pending, 1);
+	}
+
+	return err;
+}
+
+void cpal_pool_join(struct cpal_pool *pool)
+{
+	if (pool == NULL) {
+		return;
+	}
+
+	pool_wait(pool, &pool->submitted);
+}
+
+void cpal_pool_parallel_for(struct cpal_pool *pool, const size_t begin,
+			    const size_t end, const size_t grain,
+			    cpal_pool_range_fn fn, void *arg)
+{
+	struct pool_range range = {fn, arg, grain > 0 ? grain : 1};
+	struct pool_group group;
+
+	if (begin >= end) {
+		return;
+	}
+
+	if (pool == NULL) {
+		fn(arg, begin, end);
+		return;
+	}
+
+	atomic_init(&group.pending, 1);
+	pool_run_range(pool, &range, begin, end, &group);
+	pool_group_done(pool, &group);
+	pool_wait(pool, &group);
+}
@@ -0,0 +1,80 @@
+/*
+ * Key searches specialized for each cipher and scorer, so that decrypting and
+ * scoring a candidate is one fused loop with no calls through function pointers.
+ * The scorer of a model is only looked at once per search, to pick the loop.
+ */
+
+#include "utils_analysis_internal.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+
+ANALYSIS_DEFINE_SEARCH(analysis_xor_histogram, xor, histogram)
+ANALYSIS_DEFINE_SEARCH(analysis_xor_log_likelihood, xor, log_likelihood)
+
+double cpal_analysis_score_xor(const struct cpal_analysis_model *model,
+			       const uint8_t *ciphertext, const size_t len,
+			       const uint8_t *key, const size_t key_len)
+{
+	if (key_len == 0) {
+		return -INFINITY;
+	}
+
+	if (model->scorer == CPAL_ANALYSIS_LOG_LIKELIHOOD) {
+		return analysis_xor_log_likelihood_score(model, ciphertext, len, key,
+							 key_len);
+	}
+
+	return analysis_xor_histogram_score(model, ciphertext, len, key, key_len);
+}
+
+int cpal_analysis_search_xor(const struct cpal_analysis_model *model,
+			     const uint8_t *ciphertext, const size_t len,
+			     const uint8_t *keys, const size_t key_len,
+			     const size_t key_count, const size_t idx,
+			     struct cpal_analysis_top *top)
+{
+	if ((ciphertext == NULL && len > 0) || (keys == NULL && key_count > 0) ||
+	    key_len == 0) {
+		return -EINVAL;
+	}
+
+	if (model->scorer == CPAL_ANALYSIS_LOG_LIKELIHOOD) {
+		analysis_xor_log_likelihood_search(model, ciphertext, len, keys,
+						   key_len, key_count, idx, top);
+	} else {
+		analysis_xor_histogram_search(model, ciphertext, len, keys, key_len,
+					      key_count, idx, top);
+	}
+
+	return 0;
+}
+
+int cpal_analysis_search_xor_pruned(const struct cpal_analysis_model *model,
+				    const uint8_t *ciphertext, const size_t len,
+				    const uint8_t *keys, const size_t key_len,
+				    const size_t key_count, const size_t idx,
+				    struct cpal_analysis_top *top,
+				    const double min_printable)
+{
+	size_t pruned;
+
+	if ((ciphertext == NULL && len > 0) || (keys == NULL && key_count > 0) ||
+	    key_len == 0 || key_count > INT_MAX ||
+	    !(min_printable >= 0.0 && min_printable <= 1.0)) {
+		return -EINVAL;
+	}
+
+	if (model->scorer == CPAL_ANALYSIS_LOG_LIKELIHOOD) {
+		pruned = analysis_xor_log_likelihood_search_pruned(
+		    model, ciphertext, len, keys, key_len, key_count, idx, top,
+		    min_printable);
+	} else {
+		pruned = analysis_xor_histogram_search_pruned(
+		    model, ciphertext, len, keys, key_len, key_count, idx, top,
+		    min_printable);
+	}
+
+	return (int)pruned;
+}
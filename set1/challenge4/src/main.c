@@ -7,50 +7,32 @@
 #include <stdio.h>
 #include <string.h>
 
-static double ENGLISH_FREQ_TABLE[256];
-
-//@todo - make these functions available from libcryptopal-common
-
-static double english_freq_bhattacharyya_score(const uint8_t *ciphertext,
-					       const size_t len)
+/**
+ * The longest decoded line of the challenge input.
+ */
+#define CHALLENGE4_MAX_LINE_LEN 64
+
+/**
+ * Decode every line of the challenge input into @corpus, packed back-to-back,
+ * with line i starting at @offsets[i].  Lines that fail to decode are left empty.
+ */
+static void decode_corpus(uint8_t *corpus, size_t *offsets)
 {
-	return cpal_analysis_bhattacharyya_score(ENGLISH_FREQ_TABLE, ciphertext,
-						 len);
-}
+	size_t pos = 0;
 
-static int xor_decrypt(const uint8_t *key, const size_t key_len,
-		       const uint8_t *ciphertext, size_t len, uint8_t **output,
-		       size_t *output_len)
-{
-	if (key_len != 1) {
-		return -1;
-	}
-
-	int res = cpal_cipher_xor_bytewise(ciphertext, len, *key, output);
-	if (res == 0) {
-		*output_len = len;
-	}
-
-	return res;
-}
+	for (size_t idx = 0; idx < CHALLENGE4_NUM_STRINGS; idx++) {
+		const char *input = CHALLENGE4_STRINGS[idx];
+		size_t decoded_len = CHALLENGE4_MAX_LINE_LEN;
 
-static int decode_and_score(const char *input, uint8_t key,
-			    struct cpal_analysis_key_score *score)
-{
-	uint8_t *decoded = NULL;
-	size_t decoded_len;
+		offsets[idx] = pos;
 
-	int ret = cpal_base16_decode(input, strlen(input), &decoded, &decoded_len);
-	if (ret < 0) {
-		return ret;
+		if (cpal_base16_decode_into(input, strlen(input), corpus + pos,
+					    &decoded_len) == 0) {
+			pos += decoded_len;
+		}
 	}
 
-	int res =
-	    cpal_analysis_try_key(decoded, decoded_len, &key, 1, score,
-				  english_freq_bhattacharyya_score, xor_decrypt);
-
-	free(decoded);
-	return res;
+	offsets[CHALLENGE4_NUM_STRINGS] = pos;
 }
 
 int main(int argc, char *argv[])
@@ -63,60 +45,59 @@ int main(int argc, char *argv[])
 	static const char *expected_best_plaintext =
 	    "Now that the party is jumping";
 
-	cpal_analysis_init_english_probabilities(ENGLISH_FREQ_TABLE);
+	const struct cpal_analysis_model *english =
+	    cpal_analysis_english_model(CPAL_ANALYSIS_BHATTACHARYYA);
 
-	struct cpal_analysis_key_score **scores =
-	    calloc(CHALLENGE4_NUM_STRINGS, sizeof *scores);
-	if (scores == NULL) {
+	uint8_t *corpus = calloc(CHALLENGE4_NUM_STRINGS, CHALLENGE4_MAX_LINE_LEN);
+	size_t *offsets = calloc(CHALLENGE4_NUM_STRINGS + 1, sizeof *offsets);
+	double *scores = calloc(CHALLENGE4_NUM_STRINGS, sizeof *scores);
+	uint8_t *keys = calloc(CHALLENGE4_NUM_STRINGS, sizeof *keys);
+	size_t *lines = calloc(CHALLENGE4_NUM_STRINGS, sizeof *lines);
+	struct cpal_analysis_batch batch;
+	uint8_t decrypted[CHALLENGE4_MAX_LINE_LEN];
+
+	if (corpus == NULL || offsets == NULL || scores == NULL || keys == NULL ||
+	    lines == NULL) {
 		goto exit;
 	}
 
-	int best_idx = 0;
-	unsigned int best_key = 0;
-	double best_score = 0.0;
-
-	for (size_t idx = 0; idx < CHALLENGE4_NUM_STRINGS; idx++) {
-		struct cpal_analysis_key_score *key_scores =
-		    calloc(256, sizeof *key_scores);
-
-		for (unsigned int key = 0; key < 256; key++) {
-			if (decode_and_score(CHALLENGE4_STRINGS[idx], key,
-					     &key_scores[key]) < 0) {
-				continue;
-			}
-
-			if (key_scores[key].score > best_score) {
-				best_score = key_scores[key].score;
-				best_idx = idx;
-				best_key = key;
-			}
-		}
+	decode_corpus(corpus, offsets);
+	cpal_analysis_batch_init(&batch, scores, keys, lines, CHALLENGE4_NUM_STRINGS);
 
-		scores[idx] = key_scores;
+	if (cpal_analysis_batch_single_byte_xor(english, corpus, offsets,
+						CHALLENGE4_NUM_STRINGS, &batch,
+						NULL) < 0) {
+		goto exit;
 	}
 
-	printf(
-	    "best_string=%s, best_idx=%d, best_key=%#02x best_score=%f, decrypted=",
-	    CHALLENGE4_STRINGS[best_idx], best_idx, best_key, best_score);
-	cpal_util_printbuf(scores[best_idx][best_key].decrypted,
-			   scores[best_idx][best_key].decrypted_len);
-	printf("\n");
+	cpal_analysis_batch_sort(&batch);
 
-	ret = strncmp(expected_best_plaintext,
-		      (char *)scores[best_idx][best_key].decrypted,
-		      strlen(expected_best_plaintext));
-exit:
-	if (scores != NULL) {
-		for (size_t idx = 0; idx < CHALLENGE4_NUM_STRINGS; idx++) {
-			for (unsigned int key = 0; key < 256; key++) {
-				free(scores[idx][key].key);
-				free(scores[idx][key].decrypted);
-			}
-
-			free(scores[idx]);
-		}
+	// Only the winning lines are decrypted
+	for (size_t rank = 0; rank < 3 && rank < batch.len; rank++) {
+		size_t idx = lines[rank];
+		size_t len = offsets[idx + 1] - offsets[idx];
+
+		cpal_cipher_xor_bytewise_into(corpus + offsets[idx], len, keys[rank],
+					      decrypted);
+
+		printf("rank=%zu, string=%s, idx=%zu, key=%#02x, score=%f, "
+		       "decrypted=",
+		       rank + 1, CHALLENGE4_STRINGS[idx], idx, keys[rank],
+		       scores[rank]);
+		cpal_util_printbuf(decrypted, len);
+		printf("\n");
 
-		free(scores);
+		if (rank == 0) {
+			ret = strncmp(expected_best_plaintext, (char *)decrypted,
+				      strlen(expected_best_plaintext));
+		}
 	}
+
+exit:
+	free(corpus);
+	free(offsets);
+	free(scores);
+	free(keys);
+	free(lines);
 	return ret;
 }
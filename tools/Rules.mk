@@ -0,0 +1,13 @@
+sp 		:= $(sp).x
+dirstack_$(sp)	:= $(d)
+d		:= $(dir)
+
+dir	:= $(d)/codec
+include		$(dir)/Rules.mk
+dir	:= $(d)/ngram
+include		$(dir)/Rules.mk
+
+-include	$(DEPS_$(d))
+
+d		:= $(dirstack_$(sp))
+sp		:= $(basename $(sp))
@@ -0,0 +1,308 @@
+/*
+ * Convert files between raw bytes and any of the RFC 4648 encodings.
+ *
+ * Both files are memory-mapped and the conversion writes straight into the
+ * mapping of the output file, so nothing is copied through the heap no matter
+ * how large the files are.
+ */
+
+#include <cryptopal-common.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * The number of encoded characters decoded at once when converting between two
+ * encodings, and the buffer they are decoded into before being re-encoded.
+ */
+#define TRANSCODE_CHUNK_CHARS (1 << 20)
+static uint8_t TRANSCODE_BUFFER[TRANSCODE_CHUNK_CHARS];
+
+struct codec {
+	const char *name;
+	int (*decode_parallel)(const char *, const size_t, uint8_t *, size_t *,
+			       unsigned int);
+	int (*encode_parallel)(const uint8_t *, const size_t, char *, size_t *,
+			       unsigned int);
+	size_t (*decoded_len)(const char *, const size_t);
+	size_t (*encoded_len)(const size_t);
+	void (*decoder_init)(struct cpal_rfc4648_decoder *);
+	void (*encoder_init)(struct cpal_rfc4648_encoder *);
+};
+
+static const struct codec CODECS[] = {
+    {"raw", NULL, NULL, NULL, NULL, NULL, NULL},
+    {"base16", cpal_base16_decode_parallel, cpal_base16_encode_parallel,
+     cpal_base16_decoded_len, cpal_base16_encoded_len, cpal_base16_decoder_init,
+     cpal_base16_encoder_init},
+    {"base32", cpal_base32_decode_parallel, cpal_base32_encode_parallel,
+     cpal_base32_decoded_len, cpal_base32_encoded_len, cpal_base32_decoder_init,
+     cpal_base32_encoder_init},
+    {"base32hex", cpal_base32hex_decode_parallel, cpal_base32hex_encode_parallel,
+     cpal_base32hex_decoded_len, cpal_base32hex_encoded_len,
+     cpal_base32hex_decoder_init, cpal_base32hex_encoder_init},
+    {"base64", cpal_base64_decode_parallel, cpal_base64_encode_parallel,
+     cpal_base64_decoded_len, cpal_base64_encoded_len, cpal_base64_decoder_init,
+     cpal_base64_encoder_init},
+    {"base64safe", cpal_base64safe_decode_parallel,
+     cpal_base64safe_encode_parallel, cpal_base64safe_decoded_len,
+     cpal_base64safe_encoded_len, cpal_base64safe_decoder_init,
+     cpal_base64safe_encoder_init},
+};
+
+static const struct codec *find_codec(const char *name)
+{
+	for (size_t i = 0; i < sizeof(CODECS) / sizeof(*CODECS); i++) {
+		if (strcmp(CODECS[i].name, name) == 0) {
+			return &CODECS[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void usage(const char *program)
+{
+	fprintf(stderr, "usage: %s <from> <to> <input> <output>\n", program);
+	fprintf(stderr, "encodings:");
+
+	for (size_t i = 0; i < sizeof(CODECS) / sizeof(*CODECS); i++) {
+		fprintf(stderr, " %s", CODECS[i].name);
+	}
+
+	fprintf(stderr, "\n");
+}
+
+static double elapsed_seconds(const struct timespec *start)
+{
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (double)(end.tv_sec - start->tv_sec) +
+	       (double)(end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/**
+ * Calculate the size of the converted output.  Encoded input must be made up of
+ * whole, padded groups, which is checked before this is called.
+ */
+static size_t converted_size(const struct codec *from, const struct codec *to,
+			     const char *input, size_t input_size)
+{
+	size_t raw_size = input_size;
+
+	if (from->decoded_len != NULL) {
+		raw_size = from->decoded_len(input, input_size);
+	}
+
+	return to->encoded_len != NULL ? to->encoded_len(raw_size) : raw_size;
+}
+
+/**
+ * Convert between two encodings by decoding a chunk at a time into a fixed
+ * buffer and encoding it straight into @output.
+ */
+static int transcode(const struct codec *from, const struct codec *to,
+		     const char *input, size_t input_size, char *output,
+		     size_t output_size)
+{
+	struct cpal_rfc4648_decoder decoder;
+	struct cpal_rfc4648_encoder encoder;
+	size_t input_pos = 0;
+	size_t output_pos = 0;
+	size_t decoded;
+	size_t encoded;
+	int ret;
+
+	from->decoder_init(&decoder);
+	to->encoder_init(&encoder);
+
+	while (input_pos < input_size) {
+		size_t chunk = input_size - input_pos;
+
+		if (chunk > TRANSCODE_CHUNK_CHARS) {
+			chunk = TRANSCODE_CHUNK_CHARS;
+		}
+
+		decoded = sizeof(TRANSCODE_BUFFER);
+		ret = cpal_rfc4648_decoder_update(&decoder, input + input_pos, chunk,
+						  TRANSCODE_BUFFER, &decoded);
+		if (ret < 0) {
+			return ret;
+		}
+
+		encoded = output_size - output_pos;
+		ret = cpal_rfc4648_encoder_update(&encoder, TRANSCODE_BUFFER, decoded,
+						  output + output_pos, &encoded);
+		if (ret < 0) {
+			return ret;
+		}
+
+		input_pos += chunk;
+		output_pos += encoded;
+	}
+
+	decoded = sizeof(TRANSCODE_BUFFER);
+	ret = cpal_rfc4648_decoder_finalize(&decoder, TRANSCODE_BUFFER, &decoded);
+	if (ret < 0) {
+		return ret;
+	}
+
+	encoded = output_size - output_pos;
+	ret = cpal_rfc4648_encoder_update(&encoder, TRANSCODE_BUFFER, decoded,
+					  output + output_pos, &encoded);
+	if (ret < 0) {
+		return ret;
+	}
+
+	output_pos += encoded;
+	encoded = output_size - output_pos;
+
+	return cpal_rfc4648_encoder_finalize(&encoder, output + output_pos,
+					     &encoded);
+}
+
+static int convert(const struct codec *from, const struct codec *to,
+		   const char *input, size_t input_size, char *output,
+		   size_t output_size)
+{
+	if (from->decode_parallel == NULL && to->encode_parallel == NULL) {
+		memcpy(output, input, input_size);
+		return 0;
+	}
+
+	if (from->decode_parallel == NULL) {
+		return to->encode_parallel((const uint8_t *)input, input_size, output,
+					   &output_size, 0);
+	}
+
+	if (to->encode_parallel == NULL) {
+		return from->decode_parallel(input, input_size, (uint8_t *)output,
+					     &output_size, 0);
+	}
+
+	return transcode(from, to, input, input_size, output, output_size);
+}
+
+int main(int argc, char *argv[])
+{
+	int ret = 1;
+	int input_fd = -1;
+	int output_fd = -1;
+	char *input = MAP_FAILED;
+	char *output = MAP_FAILED;
+	size_t input_size = 0;
+	size_t output_size = 0;
+
+	if (argc != 5) {
+		usage(argv[0]);
+		return ret;
+	}
+
+	const struct codec *from = find_codec(argv[1]);
+	const struct codec *to = find_codec(argv[2]);
+
+	if (from == NULL || to == NULL) {
+		usage(argv[0]);
+		return ret;
+	}
+
+	struct stat input_stat;
+
+	input_fd = open(argv[3], O_RDONLY);
+	if (input_fd < 0 || fstat(input_fd, &input_stat) < 0) {
+		perror(argv[3]);
+		goto exit;
+	}
+
+	input_size = input_stat.st_size;
+
+	if (input_size > 0) {
+		input = mmap(NULL, input_size, PROT_READ, MAP_PRIVATE, input_fd, 0);
+		if (input == MAP_FAILED) {
+			perror("mmap");
+			goto exit;
+		}
+
+		madvise(input, input_size, MADV_SEQUENTIAL);
+	}
+
+	// Encoded files usually end with a newline, which isn't part of the data
+	while (from->decoded_len != NULL && input_size > 0 &&
+	       (input[input_size - 1] == '\n' || input[input_size - 1] == '\r')) {
+		input_size--;
+	}
+
+	// Every scheme pads a single byte out to a whole group
+	if (from->encoded_len != NULL && input_size % from->encoded_len(1) != 0) {
+		fprintf(stderr, "%s is not valid %s\n", argv[3], from->name);
+		goto exit;
+	}
+
+	output_size = converted_size(from, to, input, input_size);
+
+	output_fd = open(argv[4], O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (output_fd < 0 || ftruncate(output_fd, output_size) < 0) {
+		perror(argv[4]);
+		goto exit;
+	}
+
+	if (output_size > 0) {
+		output = mmap(NULL, output_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			      output_fd, 0);
+		if (output == MAP_FAILED) {
+			perror("mmap");
+			goto exit;
+		}
+	}
+
+	struct timespec start;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	int err = convert(from, to, input, input_size, output, output_size);
+
+	if (err < 0) {
+		fprintf(stderr, "failed converting %s from %s to %s: %s\n", argv[3],
+			from->name, to->name, strerror(-err));
+		goto exit;
+	}
+
+	double seconds = elapsed_seconds(&start);
+
+	fprintf(stderr, "converted %zu bytes to %zu bytes in %.3fs (%.1f MB/s)\n",
+		input_size, output_size, seconds,
+		seconds > 0 ? (double)input_size / seconds / 1e6 : 0.0);
+
+	ret = 0;
+exit:
+	if (output != MAP_FAILED) {
+		munmap(output, output_size);
+	}
+
+	if (input != MAP_FAILED) {
+		munmap(input, input_stat.st_size);
+	}
+
+	if (output_fd >= 0) {
+		close(output_fd);
+
+		// Don't leave a full size file of partial output behind
+		if (ret != 0) {
+			unlink(argv[4]);
+		}
+	}
+
+	if (input_fd >= 0) {
+		close(input_fd);
+	}
+
+	return ret;
+}
@@ -0,0 +1,143 @@
+/*
+ * Build n-gram model files for scoring English text, and score files with them.
+ *
+ * The corpus is memory-mapped and counted in place, and the model written is
+ * ready to be memory-mapped by @cpal_ngram_model_open as it is.
+ */
+
+#include <cryptopal-common.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void usage(const char *program)
+{
+	fprintf(stderr, "usage: %s build <order> <corpus> <model>\n", program);
+	fprintf(stderr, "       %s score <model> <input>\n", program);
+}
+
+/**
+ * Map the file at @path into @data, or leave @data as MAP_FAILED if it's empty.
+ *
+ * @return The file descriptor of @path, or < 0 on failure.
+ */
+static int map_file(const char *path, uint8_t **data, size_t *len)
+{
+	struct stat st;
+	int fd = open(path, O_RDONLY);
+
+	*data = MAP_FAILED;
+	*len = 0;
+
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		perror(path);
+		goto error;
+	}
+
+	*len = st.st_size;
+
+	if (*len > 0) {
+		*data = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (*data == MAP_FAILED) {
+			perror("mmap");
+			goto error;
+		}
+
+		madvise(*data, *len, MADV_SEQUENTIAL);
+	}
+
+	return fd;
+error:
+	if (fd >= 0) {
+		close(fd);
+	}
+
+	return -1;
+}
+
+static int build(const char *order_arg, const char *corpus_path,
+		 const char *model_path)
+{
+	uint8_t class_map[256];
+	uint8_t *corpus;
+	size_t len;
+	char *end;
+
+	unsigned long order = strtoul(order_arg, &end, 10);
+
+	if (*end != '\0' || order == 0 || order > 8) {
+		fprintf(stderr, "invalid order %s\n", order_arg);
+		return 1;
+	}
+
+	int fd = map_file(corpus_path, &corpus, &len);
+
+	if (fd < 0) {
+		return 1;
+	}
+
+	unsigned int class_bits = cpal_ngram_english_classes(class_map);
+	int err = cpal_ngram_model_build(len > 0 ? corpus : NULL, len, class_map,
+					 class_bits, order, model_path);
+
+	if (err < 0) {
+		fprintf(stderr, "failed building %s: %s\n", model_path, strerror(-err));
+	}
+
+	if (corpus != MAP_FAILED) {
+		munmap(corpus, len);
+	}
+
+	close(fd);
+	return err < 0;
+}
+
+static int score(const char *model_path, const char *input_path)
+{
+	struct cpal_ngram_model model;
+	uint8_t *input;
+	size_t len;
+
+	int err = cpal_ngram_model_open(&model, model_path);
+
+	if (err < 0) {
+		fprintf(stderr, "failed opening %s: %s\n", model_path, strerror(-err));
+		return 1;
+	}
+
+	int fd = map_file(input_path, &input, &len);
+
+	if (fd < 0) {
+		cpal_ngram_model_close(&model);
+		return 1;
+	}
+
+	printf("%f\n", cpal_ngram_model_score(&model, input, len));
+
+	if (input != MAP_FAILED) {
+		munmap(input, len);
+	}
+
+	close(fd);
+	cpal_ngram_model_close(&model);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc == 5 && strcmp(argv[1], "build") == 0) {
+		return build(argv[2], argv[3], argv[4]);
+	}
+
+	if (argc == 4 && strcmp(argv[1], "score") == 0) {
+		return score(argv[2], argv[3]);
+	}
+
+	usage(argv[0]);
+	return 1;
+}